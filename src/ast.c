@@ -31,21 +31,39 @@ static char *condOpSym[] = { " <= ", " < ",  " == ", " != ", " > ", " >= ", " &
                              " | ",  " ^ ",  " ~ ",  " + ",  " - ", " * ",  " / ",
                              " >> ", " << ", " % ",  " && ", " || " };
 
-#define EXP_SIZE 200 // Size of the expression buffer
+#define EXP_BLOCK_SIZE 256 // # expression nodes per arena block
 
-// Local expression stack
-typedef struct _EXP_STK {
-    COND_EXPR *exp;
-    struct _EXP_STK *next;
-} EXP_STK;
+// Block of expression nodes of an arena
+struct _expBlock {
+    struct _expBlock *next;
+    int used;                       // # nodes handed out
+    COND_EXPR node[EXP_BLOCK_SIZE];
+};
 
-static EXP_STK *expStk = NULL; // local expression stack
+#define HL_BLOCK_SIZE 8 // # HIGH_LEVEL icode parts per arena block
+
+// Block of HIGH_LEVEL icode parts of an arena
+struct _hlBlock {
+    struct _hlBlock *next;
+    int used;                       // # parts handed out
+    struct _hl hl[HL_BLOCK_SIZE];
+};
+
+static EXP_ARENA progArena;            // Arena used when no procedure's arena is selected
+static _Thread_local EXP_ARENA *curArena = &progArena; // Arena new expression nodes come from
+
+#define EXP_STK_INIT 16 // Initial # slots of the expression stack
+
+// Local expression stack, an array that is kept (not freed) from one procedure to the next
+static _Thread_local COND_EXPR **expStk = NULL;
+static _Thread_local int numExpStk = 0;   // # expressions on the stack
+static _Thread_local int allocExpStk = 0; // # slots allocated
 
 
 // Returns the integer i in C hexadecimal format
 static char *hexStr(int i)
 {
-    static char buf[10];
+    static _Thread_local char buf[10];
 
     i &= 0xFFFF;
     sprintf(buf, "%s%X", (i > 9) ? "0x" : "", i);
@@ -59,14 +77,14 @@ void setRegDU(PICODE pIcode, uint8_t regi, operDu du)
     switch ((int)du) {
     case DEF:
         pIcode->du.def |= duReg[regi];
-        pIcode->du1.numRegsDef++;
+        pIcode->numRegsDef++;
         break;
     case USE:
         pIcode->du.use |= duReg[regi];
         break;
     case USE_DEF:
         pIcode->du.def |= duReg[regi];
-        pIcode->du1.numRegsDef++;
+        pIcode->numRegsDef++;
         pIcode->du.use |= duReg[regi];
         break;
     case NONE: // do nothing
@@ -96,11 +114,70 @@ void copyDU(PICODE pIcode, PICODE duIcode, operDu du, operDu duDu)
     }
 }
 
+/*
+ Selects the arena new expression nodes are allocated from, normally that of the procedure
+ being analysed, and returns the previously selected one. NULL selects the program's arena.
+*/
+EXP_ARENA *setExpArena(EXP_ARENA *arena)
+{
+    EXP_ARENA *prev = curArena;
+
+    curArena = arena ? arena : &progArena;
+    return prev;
+}
+
+// Releases all the expression nodes and HIGH_LEVEL icode parts allocated from the arena
+void freeExpArena(EXP_ARENA *arena)
+{
+    EXP_BLOCK *next;
+    HL_BLOCK *nextHl;
+
+    for (EXP_BLOCK *b = arena->blocks; b; b = next) {
+        next = b->next;
+        free(b);
+    }
+    arena->blocks = NULL;
+
+    for (HL_BLOCK *b = arena->hlBlocks; b; b = nextHl) {
+        nextHl = b->next;
+        free(b);
+    }
+    arena->hlBlocks = NULL;
+}
+
+// Returns a cleared HIGH_LEVEL icode part from the current arena
+struct _hl *allocHlPart(void)
+{
+    HL_BLOCK *b = curArena->hlBlocks;
+
+    if (b == NULL || b->used == HL_BLOCK_SIZE) {
+        b = allocStruc(HL_BLOCK);
+        b->used = 0;
+        b->next = curArena->hlBlocks;
+        curArena->hlBlocks = b;
+    }
+    return memset(&b->hl[b->used++], 0, sizeof(struct _hl));
+}
+
+// Returns an uninitialised expression node from the current arena
+static COND_EXPR *allocCondExp(void)
+{
+    EXP_BLOCK *b = curArena->blocks;
+
+    if (b == NULL || b->used == EXP_BLOCK_SIZE) {
+        b = allocStruc(EXP_BLOCK);
+        b->used = 0;
+        b->next = curArena->blocks;
+        curArena->blocks = b;
+    }
+    curArena->numNodes++;
+    return &b->node[b->used++];
+}
+
 // Creates a new conditional expression node of type t and returns it
 static COND_EXPR *newCondExp(condNodeType t)
 {
-    COND_EXPR *newExp = allocStruc(COND_EXPR);
-    memset(newExp, 0, sizeof(COND_EXPR));
+    COND_EXPR *newExp = memset(allocCondExp(), 0, sizeof(COND_EXPR));
     newExp->type = t;
 
     return newExp;
@@ -137,13 +214,12 @@ COND_EXPR *idCondExpGlob(int16_t segValue, int16_t off)
 
     uint32_t adr = opAdr(segValue, off);
 
-    int i;
-    for (i = 0; i < symtab.csym; i++)
-        if (symtab.sym[i].label == adr)
-            break;
+    int i = findGlobSym(adr);
 
-    if (i == symtab.csym)
+    if (i == -1) {
         printf("Error, glob var not found in symtab\n");
+        i = symtab.csym;
+    }
  
     new->expr.ident.idNode.globIdx = i;
 
@@ -605,115 +681,96 @@ void removeRegFromLong(uint8_t regi, LOCAL_ID *locId, COND_EXPR *tree)
     }
 }
 
-// Returns the string located in image, formatted in C format.
-static char *getString(uint32_t offset)
+// Appends the string located in image, formatted in C format, to sb.
+static void writeString(strBuf *sb, uint32_t offset)
 {
     size_t len = strSize(&prog.Image[offset], '\0');
-    char *str = allocMem((len * 2 + 1) * sizeof(char));
-    str[0] = '"';
-    str[1] = '\0';
 
+    appendStrBuf(sb, "\"");
     for (size_t i = 0; i < len; i++)
-        strcat(str, cChar(prog.Image[offset + i]));
-
-    strcat(str, "\"\0");
-    return str;
+        appendStrBuf(sb, "%s", cChar(prog.Image[offset + i]));
+    appendStrBuf(sb, "\"");
 }
 
-// Walks the conditional expression tree and returns the result on a string
-char *walkCondExpr(COND_EXPR *exp, PPROC pProc, int *numLoc)
+// Walks the conditional expression tree and appends the result to sb
+void walkCondExpr(strBuf *sb, COND_EXPR *exp, PPROC pProc, int *numLoc)
 {
     int16_t off;          // temporal - for OTHER
     ID *id;               // Pointer to local identifier table
-    char *o;              // Operand string pointer
     bool needBracket;     // Determine whether parenthesis is needed
     struct _bwGlb *bwGlb; // Ptr to bwGlb structure (global indexed var)
     PSTKSYM psym;         // Pointer to argument in the stack
-    char *condExp, *e;    // Return and intermediate expressions
-
-    condExp = allocMem(EXP_SIZE * sizeof(char));
-    condExp[0] = '\0';
 
     if (exp == NULL)
-        return (condExp);
+        return;
 
     needBracket = true;
     switch (exp->type) {
     case BOOLEAN:
-        strcat(condExp, "(");
-        e = walkCondExpr(exp->expr.boolExpr.lhs, pProc, numLoc);
-        strcat(condExp, e);
-        strcat(condExp, condOpSym[exp->expr.boolExpr.op]);
-        e = walkCondExpr(exp->expr.boolExpr.rhs, pProc, numLoc);
-        strcat(condExp, e);
-        strcat(condExp, ")");
+        appendStrBuf(sb, "(");
+        walkCondExpr(sb, exp->expr.boolExpr.lhs, pProc, numLoc);
+        appendStrBuf(sb, "%s", condOpSym[exp->expr.boolExpr.op]);
+        walkCondExpr(sb, exp->expr.boolExpr.rhs, pProc, numLoc);
+        appendStrBuf(sb, ")");
         break;
 
     case NEGATION:
         if (exp->expr.unaryExp->type == IDENTIFIER) {
             needBracket = false;
-            strcat(condExp, "!");
+            appendStrBuf(sb, "!");
         } else
-            strcat(condExp, "! (");
-        e = walkCondExpr(exp->expr.unaryExp, pProc, numLoc);
-        strcat(condExp, e);
+            appendStrBuf(sb, "! (");
+        walkCondExpr(sb, exp->expr.unaryExp, pProc, numLoc);
         if (needBracket == true)
-            strcat(condExp, ")");
+            appendStrBuf(sb, ")");
         break;
 
     case ADDRESSOF:
         if (exp->expr.unaryExp->type == IDENTIFIER) {
             needBracket = false;
-            strcat(condExp, "&");
+            appendStrBuf(sb, "&");
         } else
-            strcat(condExp, "&(");
-        e = walkCondExpr(exp->expr.unaryExp, pProc, numLoc);
-        strcat(condExp, e);
+            appendStrBuf(sb, "&(");
+        walkCondExpr(sb, exp->expr.unaryExp, pProc, numLoc);
         if (needBracket == true)
-            strcat(condExp, ")");
+            appendStrBuf(sb, ")");
         break;
 
     case DEREFERENCE:
         if (exp->expr.unaryExp->type == IDENTIFIER) {
             needBracket = false;
-            strcat(condExp, "*");
+            appendStrBuf(sb, "*");
         } else
-            strcat(condExp, "*(");
-        e = walkCondExpr(exp->expr.unaryExp, pProc, numLoc);
-        strcat(condExp, e);
+            appendStrBuf(sb, "*(");
+        walkCondExpr(sb, exp->expr.unaryExp, pProc, numLoc);
         if (needBracket == true)
-            strcat(condExp, ")");
+            appendStrBuf(sb, ")");
         break;
 
     case POST_INC:
-        e = walkCondExpr(exp->expr.unaryExp, pProc, numLoc);
-        strcat(condExp, e);
-        strcat(condExp, "++");
+        walkCondExpr(sb, exp->expr.unaryExp, pProc, numLoc);
+        appendStrBuf(sb, "++");
         break;
 
     case POST_DEC:
-        e = walkCondExpr(exp->expr.unaryExp, pProc, numLoc);
-        strcat(condExp, e);
-        strcat(condExp, "--");
+        walkCondExpr(sb, exp->expr.unaryExp, pProc, numLoc);
+        appendStrBuf(sb, "--");
         break;
 
     case PRE_INC:
-        strcat(condExp, "++");
-        e = walkCondExpr(exp->expr.unaryExp, pProc, numLoc);
-        strcat(condExp, e);
+        appendStrBuf(sb, "++");
+        walkCondExpr(sb, exp->expr.unaryExp, pProc, numLoc);
         break;
 
     case PRE_DEC:
-        strcat(condExp, "--");
-        e = walkCondExpr(exp->expr.unaryExp, pProc, numLoc);
-        strcat(condExp, e);
+        appendStrBuf(sb, "--");
+        walkCondExpr(sb, exp->expr.unaryExp, pProc, numLoc);
         break;
 
     case IDENTIFIER:
-        o = allocMem(operandSize);
         switch (exp->expr.ident.idType) {
         case GLOB_VAR:
-            sprintf(o, "%s", symtab.sym[exp->expr.ident.idNode.globIdx].name);
+            appendStrBuf(sb, "%s", symtab.sym[exp->expr.ident.idNode.globIdx].name);
             break;
         case REGISTER:
             id = &pProc->localId.id[exp->expr.ident.idNode.regiIdx];
@@ -728,80 +785,77 @@ char *walkCondExpr(COND_EXPR *exp, PPROC pProc, int *numLoc)
                                  byteReg[id->id.regi - rAL]);
             }
             if (id->hasMacro)
-                sprintf(o, "%s(%s)", id->macro, id->name);
+                appendStrBuf(sb, "%s(%s)", id->macro, id->name);
             else
-                sprintf(o, "%s", id->name);
+                appendStrBuf(sb, "%s", id->name);
             break;
 
         case LOCAL_VAR:
-            sprintf(o, "%s", pProc->localId.id[exp->expr.ident.idNode.localIdx].name);
+            appendStrBuf(sb, "%s", pProc->localId.id[exp->expr.ident.idNode.localIdx].name);
             break;
 
         case PARAM:
             psym = &pProc->args.sym[exp->expr.ident.idNode.paramIdx];
             if (psym->hasMacro)
-                sprintf(o, "%s(%s)", psym->macro, psym->name);
+                appendStrBuf(sb, "%s(%s)", psym->macro, psym->name);
             else
-                sprintf(o, "%s", psym->name);
+                appendStrBuf(sb, "%s", psym->name);
             break;
 
         case GLOB_VAR_IDX:
             bwGlb = &pProc->localId.id[exp->expr.ident.idNode.idxGlbIdx].id.bwGlb;
 
-            sprintf(o, "%d[%s]", (bwGlb->seg << 4) + bwGlb->off, wordReg[bwGlb->regi - rAX]);
+            appendStrBuf(sb, "%d[%s]", (bwGlb->seg << 4) + bwGlb->off, wordReg[bwGlb->regi - rAX]);
             break;
 
         case CONST:
             if (exp->expr.ident.idNode.kte.kte < 1000)
-                sprintf(o, "%d", exp->expr.ident.idNode.kte.kte);
+                appendStrBuf(sb, "%d", exp->expr.ident.idNode.kte.kte);
             else
-                sprintf(o, "0x%X", exp->expr.ident.idNode.kte.kte);
+                appendStrBuf(sb, "0x%X", exp->expr.ident.idNode.kte.kte);
             break;
 
         case STRING:
-            o = getString(exp->expr.ident.idNode.strIdx);
+            writeString(sb, exp->expr.ident.idNode.strIdx);
             break;
 
         case LONG_VAR:
             id = &pProc->localId.id[exp->expr.ident.idNode.longIdx];
             if (id->name[0] != '\0') // STK_FRAME & REG w/name
-                sprintf(o, "%s", id->name);
+                appendStrBuf(sb, "%s", id->name);
             else if (id->loc == REG_FRAME) {
                 sprintf(id->name, "loc%d", ++(*numLoc));
                 appendStrTab(&cCode.decl, "%s %s; /* %s:%s */\n", hlTypes[id->type], id->name,
                              wordReg[id->id.longId.h - rAX], wordReg[id->id.longId.l - rAX]);
-                sprintf(o, "%s", id->name);
+                appendStrBuf(sb, "%s", id->name);
                 propLongId(&pProc->localId, id->id.longId.l, id->id.longId.h, id->name);
             } else { // GLB_FRAME
                 if (id->id.longGlb.regi == 0) // not indexed
-                    sprintf(o, "[%d]", (id->id.longGlb.seg << 4) + id->id.longGlb.offH);
+                    appendStrBuf(sb, "[%d]", (id->id.longGlb.seg << 4) + id->id.longGlb.offH);
                 else if (id->id.longGlb.regi == rBX)
-                    sprintf(o, "[%d][bx]", (id->id.longGlb.seg << 4) + id->id.longGlb.offH);
+                    appendStrBuf(sb, "[%d][bx]", (id->id.longGlb.seg << 4) + id->id.longGlb.offH);
             }
             break;
 
         case FUNCTION:
-            o = writeCall(exp->expr.ident.idNode.call.proc, exp->expr.ident.idNode.call.args, pProc,
-                          numLoc);
+            writeCall(sb, exp->expr.ident.idNode.call.proc, exp->expr.ident.idNode.call.args, pProc,
+                      numLoc);
             break;
 
         case OTHER:
             off = exp->expr.ident.idNode.other.off;
             if (off == 0)
-                sprintf(o, "%s[%s]", wordReg[exp->expr.ident.idNode.other.seg - rAX],
-                        idxReg[exp->expr.ident.idNode.other.regi - INDEXBASE]);
+                appendStrBuf(sb, "%s[%s]", wordReg[exp->expr.ident.idNode.other.seg - rAX],
+                             idxReg[exp->expr.ident.idNode.other.regi - INDEXBASE]);
             else if (off < 0)
-                sprintf(o, "%s[%s-%s]", wordReg[exp->expr.ident.idNode.other.seg - rAX],
-                        idxReg[exp->expr.ident.idNode.other.regi - INDEXBASE], hexStr(-off));
+                appendStrBuf(sb, "%s[%s-%s]", wordReg[exp->expr.ident.idNode.other.seg - rAX],
+                             idxReg[exp->expr.ident.idNode.other.regi - INDEXBASE], hexStr(-off));
             else
-                sprintf(o, "%s[%s+%s]", wordReg[exp->expr.ident.idNode.other.seg - rAX],
-                        idxReg[exp->expr.ident.idNode.other.regi - INDEXBASE], hexStr(off));
+                appendStrBuf(sb, "%s[%s+%s]", wordReg[exp->expr.ident.idNode.other.seg - rAX],
+                             idxReg[exp->expr.ident.idNode.other.regi - INDEXBASE], hexStr(off));
         }
-        strcat(condExp, o);
         break;
     }
-
-    return condExp;
 }
 
 // Makes a copy of the given expression. Allocates new storage for each node. Returns the copy.
@@ -812,7 +866,7 @@ COND_EXPR *copyCondExp(COND_EXPR *exp)
     switch (exp->type) {
     default: break;
     case BOOLEAN:
-        newExp = memcpy(allocStruc(COND_EXPR), exp, sizeof(COND_EXPR));
+        newExp = memcpy(allocCondExp(), exp, sizeof(COND_EXPR));
         newExp->expr.boolExpr.lhs = copyCondExp(exp->expr.boolExpr.lhs);
         newExp->expr.boolExpr.rhs = copyCondExp(exp->expr.boolExpr.rhs);
         break;
@@ -820,12 +874,12 @@ COND_EXPR *copyCondExp(COND_EXPR *exp)
     case NEGATION:
     case ADDRESSOF:
     case DEREFERENCE:
-        newExp = memcpy(allocStruc(COND_EXPR), exp, sizeof(COND_EXPR));
+        newExp = memcpy(allocCondExp(), exp, sizeof(COND_EXPR));
         newExp->expr.unaryExp = copyCondExp(exp->expr.unaryExp);
         break;
 
     case IDENTIFIER:
-        newExp = memcpy(allocStruc(COND_EXPR), exp, sizeof(COND_EXPR));
+        newExp = memcpy(allocCondExp(), exp, sizeof(COND_EXPR));
     }
     return newExp;
 }
@@ -905,86 +959,53 @@ bool insertSubTreeLongReg(COND_EXPR *exp, COND_EXPR **tree, int longIdx)
     return false;
 }
 
-// Recursively deallocates the abstract syntax tree rooted at *exp
-void freeCondExpr(COND_EXPR *exp)
-{
-    switch (exp->type) {
-    default: break;
-    case BOOLEAN:
-        freeCondExpr(exp->expr.boolExpr.lhs);
-        freeCondExpr(exp->expr.boolExpr.rhs);
-        break;
-    case NEGATION:
-    case ADDRESSOF:
-    case DEREFERENCE:
-        freeCondExpr(exp->expr.unaryExp);
-        break;
-    }
-    free(exp);
-}
-
 
 // Expression stack functions
 
-// Reinitalizes the expression stack (expStk) to NULL, by freeing all the space allocated (if any).
+// Reinitalizes the expression stack (expStk) to empty. The space allocated is kept for reuse.
 void initExpStk()
 {
-    EXP_STK *top;
+    numExpStk = 0;
+}
 
-    while (expStk != NULL) {
-        top = expStk;
-        expStk = expStk->next;
-        free(top);
-    }
+// Frees this thread's expression stack
+void freeExpStk()
+{
+    free(expStk);
+    expStk = NULL;
+    numExpStk = allocExpStk = 0;
 }
 
 // Pushes the given expression onto the local stack (expStk).
 void pushExpStk(COND_EXPR *exp)
 {
-    EXP_STK *new = allocStruc(EXP_STK);
-    new->exp = exp;
-    new->next = expStk;
-    expStk = new;
+    if (numExpStk == allocExpStk) {
+        allocExpStk = allocExpStk ? allocExpStk * 2 : EXP_STK_INIT;
+        expStk = allocVar(expStk, allocExpStk * sizeof(COND_EXPR *));
+    }
+    expStk[numExpStk++] = exp;
 }
 
 /*
- Returns the element on the top of the local expression stack (expStk), and deallocates the space
- allocated by this node. If there are no elements on the stack, returns NULL.
+ Returns the element on the top of the local expression stack (expStk), and removes it from the
+ stack. If there are no elements on the stack, returns NULL.
 */
 COND_EXPR *popExpStk()
 {
-    EXP_STK *top;
-    COND_EXPR *topExp;
-
-    if (expStk != NULL) {
-        topExp = expStk->exp;
-        top = expStk;
-        expStk = expStk->next;
-        free(top);
-        return topExp;
-    } else
+    if (numExpStk > 0)
+        return expStk[--numExpStk];
+    else
         return NULL;
 }
 
 // Returns the number of elements available in the expression stack
 int numElemExpStk()
 {
-    int num = 0;
-    EXP_STK *top = expStk;
-
-    while (top) {
-        top = top->next;
-        num++;
-    }
-
-    return num;
+    return numExpStk;
 }
 
 // Returns whether the expression stack is empty or not
 bool emptyExpStk()
 {
-    if (expStk == NULL)
-        return true;
-
-    return false;
+    return numExpStk == 0;
 }
@@ -22,8 +22,6 @@
 
 // Purpose: definition of the abstract syntax tree ADT.
 
-#define operandSize 20
-
 /*
  The following definitions and types define the Conditional Expression attributed syntax tree,
  as defined by the following EBNF:
@@ -137,6 +135,15 @@ typedef struct _condExpr {
     } expr;
 } COND_EXPR;
 
+// Arena of expression nodes and HIGH_LEVEL icode parts, released in bulk (see setExpArena in ast.c)
+typedef struct _expBlock EXP_BLOCK;
+typedef struct _hlBlock HL_BLOCK;
+typedef struct {
+    EXP_BLOCK *blocks;   // Blocks of nodes, most recent first
+    HL_BLOCK *hlBlocks;  // Blocks of HIGH_LEVEL icode parts, most recent first
+    int numNodes;        // # nodes ever allocated from the arena
+} EXP_ARENA;
+
 // Sequence of conditional expression data type
 // NOTE: not used at present
 typedef struct _condExpSeq {
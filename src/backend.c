@@ -21,9 +21,21 @@
 
 #include "dcc.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
-bundle cCode; // Procedure declaration and code
+_Thread_local bundle cCode; // Procedure declaration and code
+static _Thread_local strBuf line; // HIGH-LEVEL line or expression being written, reused
+
+// Procedure whose code is generated in parallel
+typedef struct {
+    PPROC proc;  // Procedure
+    bundle code; // Its declaration and code, once generated
+} GEN_TASK;
+
+static GEN_TASK *tasks; // Procedures in the order their code is written
+static int numTasks;    // # procedures in tasks
+static int allocTasks;  // # procedures allocated in tasks
 
 // Indentation buffer
 #define indSize 81 /* size of the indentation buffer.
@@ -35,13 +47,11 @@ static char indentBuf[indSize] =
 // Indentation according to the depth of the statement
 static char *indent(int indLevel) { return (&indentBuf[indSize - (indLevel * 4) - 1]); }
 
-// Returns a unique index to the next label @TODO WTF?
-static int getNextLabel(void)
-{
-    static int labelIdx = 1; // index of the next label
-
-    return labelIdx++;
-}
+/*
+ Returns the index of the next label of the procedure. Labels are numbered from 1 in each
+ procedure, and renumbered after those of the procedures before it when its code is written.
+*/
+static int getNextLabel(void) { return ++cCode.numLabels; }
 
 /*
  Returns the corresponding C string for the given character c.
@@ -49,7 +59,7 @@ static int getNextLabel(void)
 */
 char *cChar(char c)
 {
-    static char res[3];
+    static _Thread_local char res[3];
 
     switch (c) {
     case 0x08: // backspace
@@ -84,7 +94,7 @@ static void writeHeader(FILE *fp, char *fileName)
     appendStrTab(&cCode.decl, " * File type\t: EXE\n");
     appendStrTab(&cCode.decl, " */\n\n#include \"dcc.h\"\n\n");
 
-    writeBundle(fp, cCode);
+    writeBundle(fp, cCode, 0);
     freeBundle(&cCode);
 }
 
@@ -98,21 +108,25 @@ static void writeBitVector(uint32_t regi)
 }
 
 /*
- Checks the given icode to determine whether it has a label associated to it. If so, a goto is
- emitted to this label; otherwise, a new label is created and a goto is also emitted.
+ Checks the first icode of the given basic block to determine whether it has a label associated
+ to it. If so, a goto is emitted to this label; otherwise, a new label is created and a goto is
+ also emitted.
  Note: this procedure is to be used when the label is to be backpatched onto code in cCode.code
 */
-static void emitGotoLabel(PICODE pt, int indLevel)
+static void emitGotoLabel(PBB pBB, PPROC pProc, int indLevel)
 {
+    PICODE pt = &pProc->Icode.icode[pBB->start];
+
     if (!(pt->ll.flg & HLL_LABEL)) { // node hasn't got a lab
         // Generate new label
-        pt->ll.hllLabNum = getNextLabel();
+        pBB->hllLabNum = getNextLabel();
         pt->ll.flg |= HLL_LABEL;
 
         // Node has been traversed already, so backpatch this label into the code
-        addLabelBundle(&cCode.code, pt->codeIdx, pt->ll.hllLabNum);
+        addLabelBundle(&cCode.code, pBB->codeIdx, pBB->hllLabNum);
     }
-    appendStrTab(&cCode.code, "%sgoto L%ld;\n", indent(indLevel), pt->ll.hllLabNum);
+    appendStrTab(&cCode.code, "%s", indent(indLevel));
+    addGotoBundle(&cCode.code, pBB->hllLabNum);
 }
 
 /*
@@ -123,20 +137,20 @@ static void emitGotoLabel(PICODE pt, int indLevel)
 */
 static void writeBB(PBB pBB, PICODE hli, int lev, PPROC pProc, int *numLoc)
 {
-    char *line = NULL; // Pointer to the HIGH-LEVEL line
 
     /* Save the index into the code table in case there is a later goto
        into this instruction (first instruction of the BB) */
-    hli[pBB->start].codeIdx = nextBundleIdx(&cCode.code);
+    pBB->codeIdx = nextBundleIdx(&cCode.code);
 
     // Generate code for each hlicode that is not a JCOND
     for (int i = pBB->start, last = i + pBB->length; i < last; i++)
         if ((hli[i].type == HIGH_LEVEL) && (hli[i].invalid == false)) {
-            line = write1HlIcode(hli[i].hl, pProc, numLoc);
-            if (line[0] != '\0')
-                appendStrTab(&cCode.code, "%s%s", indent(lev), line);
+            truncStrBuf(&line, 0);
+            write1HlIcode(&line, icodeHl(&hli[i]), pProc, numLoc);
+            if (line.len != 0)
+                appendStrTab(&cCode.code, "%s%s", indent(lev), line.str);
             if (option.verbose)
-                writeDU(&hli[i], i);
+                writeDU(&pProc->Icode, i);
         }
 }
 
@@ -154,7 +168,6 @@ static void writeCode(PBB pBB, int indLevel, PPROC pProc, int *numLoc, int latch
         nodeType;    // Type of node
     PBB succ, latch; // Successor and latching node
     PICODE picode;   // Pointer to JCOND instruction
-    char *l;         // Pointer to JCOND expression
     bool emptyThen,  // THEN clause is empty
          repCond;    // Repeat condition for while()
 
@@ -182,7 +195,7 @@ static void writeCode(PBB pBB, int indLevel, PPROC pProc, int *numLoc, int latch
             picode = &pProc->Icode.icode[pBB->start + pBB->length - 1];
 
             // Check for error in while condition
-            if (picode->hl.opcode != JCOND)
+            if (icodeHl(picode).opcode != JCOND)
                 reportError(WHILE_FAIL);
 
             // Check if condition is more than 1 HL instruction
@@ -194,9 +207,10 @@ static void writeCode(PBB pBB, int indLevel, PPROC pProc, int *numLoc, int latch
             /* Condition needs to be inverted if the loop body is along
                the THEN path of the header node */
             if (pBB->edges[ELSE].BBptr->dfsLastNum == pBB->loopFollow)
-                inverseCondOp(&picode->hl.oper.exp);
-            appendStrTab(&cCode.code, "\n%swhile (%s) {\n", indent(indLevel),
-                         walkCondExpr(picode->hl.oper.exp, pProc, numLoc));
+                inverseCondOp(&icodeHl(picode).oper.exp);
+            truncStrBuf(&line, 0);
+            walkCondExpr(&line, icodeHl(picode).oper.exp, pProc, numLoc);
+            appendStrTab(&cCode.code, "\n%swhile (%s) {\n", indent(indLevel), line.str);
             invalidateIcode(picode);
             break;
 
@@ -235,7 +249,7 @@ static void writeCode(PBB pBB, int indLevel, PPROC pProc, int *numLoc, int latch
             if (succ->traversed != DFS_ALPHA)
                 writeCode(succ, indLevel, pProc, numLoc, latch->dfsLastNum, ifFollow);
             else // has been traversed so we need a goto
-                emitGotoLabel(&pProc->Icode.icode[succ->start], indLevel);
+                emitGotoLabel(succ, pProc, indLevel);
         }
 
         // Loop epilogue: generate the loop trailer
@@ -250,10 +264,11 @@ static void writeCode(PBB pBB, int indLevel, PPROC pProc, int *numLoc, int latch
         else if (loopType == ENDLESS_TYPE)
             appendStrTab(&cCode.code, "%s} /* end of loop */\n", indent(indLevel));
         else if (loopType == REPEAT_TYPE) {
-            if (picode->hl.opcode != JCOND)
+            if (icodeHl(picode).opcode != JCOND)
                 reportError(REPEAT_FAIL);
-            appendStrTab(&cCode.code, "%s} while (%s);\n", indent(indLevel),
-                         walkCondExpr(picode->hl.oper.exp, pProc, numLoc));
+            truncStrBuf(&line, 0);
+            walkCondExpr(&line, icodeHl(picode).oper.exp, pProc, numLoc);
+            appendStrTab(&cCode.code, "%s} while (%s);\n", indent(indLevel), line.str);
         }
 
         // Recurse on the loop follow
@@ -262,7 +277,7 @@ static void writeCode(PBB pBB, int indLevel, PPROC pProc, int *numLoc, int latch
             if (succ->traversed != DFS_ALPHA)
                 writeCode(succ, indLevel, pProc, numLoc, latchNode, ifFollow);
             else // has been traversed so we need a goto
-                emitGotoLabel(&pProc->Icode.icode[succ->start], indLevel);
+                emitGotoLabel(succ, pProc, indLevel);
         }
     } else { // no loop, process nodeType of the graph
         if (nodeType == TWO_BRANCH) { // if-then[-else]
@@ -275,20 +290,23 @@ static void writeCode(PBB pBB, int indLevel, PPROC pProc, int *numLoc, int latch
                 succ = pBB->edges[THEN].BBptr;
                 if (succ->traversed != DFS_ALPHA) { // not visited
                     if (succ->dfsLastNum != follow) { // THEN part
-                        l = writeJcond(pProc->Icode.icode[pBB->start + pBB->length - 1].hl,
-                                       pProc, numLoc);
-                        appendStrTab(&cCode.code, "\n%s%s", indent(indLevel - 1), l);
+                        truncStrBuf(&line, 0);
+                        writeJcond(&line, icodeHl(&pProc->Icode.icode[pBB->start + pBB->length - 1]),
+                                   pProc, numLoc);
+                        appendStrTab(&cCode.code, "\n%s%s", indent(indLevel - 1), line.str);
                         writeCode(succ, indLevel, pProc, numLoc, latchNode, follow);
                     } else { // empty THEN part => negate ELSE part
-                        l = writeJcondInv(pProc->Icode.icode[pBB->start + pBB->length - 1].hl,
-                                          pProc, numLoc);
-                        appendStrTab(&cCode.code, "\n%s%s", indent(indLevel - 1), l);
+                        truncStrBuf(&line, 0);
+                        writeJcondInv(&line,
+                                      icodeHl(&pProc->Icode.icode[pBB->start + pBB->length - 1]),
+                                      pProc, numLoc);
+                        appendStrTab(&cCode.code, "\n%s%s", indent(indLevel - 1), line.str);
                         writeCode(pBB->edges[ELSE].BBptr, indLevel, pProc, numLoc, latchNode,
                                   follow);
                         emptyThen = true;
                     }
                 } else // already visited => emit label
-                    emitGotoLabel(&pProc->Icode.icode[succ->start], indLevel);
+                    emitGotoLabel(succ, pProc, indLevel);
 
                 // process the ELSE part
                 succ = pBB->edges[ELSE].BBptr;
@@ -302,7 +320,7 @@ static void writeCode(PBB pBB, int indLevel, PPROC pProc, int *numLoc, int latch
                 } else if (!emptyThen) { // already visited => emit label
                     appendStrTab(&cCode.code, "%s}\n%selse {\n", indent(indLevel - 1),
                                  indent(indLevel - 1));
-                    emitGotoLabel(&pProc->Icode.icode[succ->start], indLevel);
+                    emitGotoLabel(succ, pProc, indLevel);
                 }
                 appendStrTab(&cCode.code, "%s}\n", indent(--indLevel));
 
@@ -311,9 +329,10 @@ static void writeCode(PBB pBB, int indLevel, PPROC pProc, int *numLoc, int latch
                 if (succ->traversed != DFS_ALPHA)
                     writeCode(succ, indLevel, pProc, numLoc, latchNode, ifFollow);
             } else { // no follow => if..then..else
-                l = writeJcond(pProc->Icode.icode[pBB->start + pBB->length - 1].hl, pProc,
-                               numLoc);
-                appendStrTab(&cCode.code, "\n%s%s", indent(indLevel - 1), l);
+                truncStrBuf(&line, 0);
+                writeJcond(&line, icodeHl(&pProc->Icode.icode[pBB->start + pBB->length - 1]), pProc,
+                           numLoc);
+                appendStrTab(&cCode.code, "\n%s%s", indent(indLevel - 1), line.str);
                 writeCode(pBB->edges[THEN].BBptr, indLevel, pProc, numLoc, latchNode, ifFollow);
                 appendStrTab(&cCode.code, "%s}\n%selse {\n", indent(indLevel - 1),
                              indent(indLevel - 1));
@@ -331,17 +350,17 @@ static void writeCode(PBB pBB, int indLevel, PPROC pProc, int *numLoc, int latch
 }
 
 /*
- Writes the procedure's declaration (including arguments), local variables,
- and invokes the procedure that writes the code of the given record *hli
+ Generates the procedure's declaration (including arguments), local variables,
+ and invokes the procedure that writes the code of the given record *hli into cCode
 */
-static void codeGen(PPROC pProc, FILE *fp)
+static void genProc(PPROC pProc)
 {
     int i, numLoc;
     PSTKFRAME args; // Procedure arguments
     char buf[200],  // Procedure's definition
          arg[30];   // One argument
     ID *locid;      // Pointer to one local identifier
-    BB *pBB;        // Pointer to basic block
+    EXP_ARENA *prevArena = setExpArena(&pProc->expArena);
 
     // Write procedure/function header
     newBundle(&cCode);
@@ -403,12 +422,25 @@ static void codeGen(PPROC pProc, FILE *fp)
         writeCode(pProc->cfg, 1, pProc, &numLoc, MAX, UN_INIT);
 
     appendStrTab(&cCode.code, "}\n\n");
-    writeBundle(fp, cCode);
-    freeBundle(&cCode);
+    setExpArena(prevArena);
+}
+
+/*
+ Writes the procedure's code, generated by genProc into procCode, to the output C file fp,
+ and frees it.
+*/
+static void writeProc(PPROC pProc, bundle *procCode, FILE *fp)
+{
+    static int labelBase = 0; // # labels used by the procedures written so far
+    BB *pBB;                  // Pointer to basic block
+
+    writeBundle(fp, *procCode, labelBase);
+    labelBase += procCode->numLabels;
+    freeBundle(procCode);
 
     // Write Live register analysis information
     if (option.verbose)
-        for (i = 0; i < pProc->numBBs; i++) {
+        for (int i = 0; i < pProc->numBBs; i++) {
             pBB = pProc->dfsLast[i];
 
             if (pBB->flg & INVALID_BB)
@@ -426,9 +458,58 @@ static void codeGen(PPROC pProc, FILE *fp)
             writeBitVector(pBB->liveIn);
             printf("\n\n");
         }
+
+    /* The procedure's expressions, HIGH_LEVEL icode parts, def/use chains and graph are not
+       needed once its code has been written */
+    freeExpArena(&pProc->expArena);
+    free(pProc->Icode.du1);
+    pProc->Icode.du1 = NULL;
+    freeBBPool(&pProc->bbPool);
+}
+
+// Frees the line buffer of this thread
+void freeLineBuf(void)
+{
+    free(line.str);
+    memset(&line, 0, sizeof(strBuf));
 }
 
-// Recursive procedure. Displays the procedure's code in depth-first order of the call graph.
+// Generates the code of the procedure of tasks[i], unless it is an assembler one.
+static void genTask(int i, void *arg)
+{
+    if (tasks[i].proc->flg & PROC_ASM)
+        return; // Generated beforehand
+
+    genProc(tasks[i].proc);
+    tasks[i].code = cCode;
+}
+
+/*
+ Generates the code of the procedures of tasks in parallel, then writes it to fp in the order of
+ tasks. The disassembler is not reentrant, so assembler procedures are generated beforehand.
+*/
+static void parallelCodeGen(FILE *fp)
+{
+    for (int i = 0; i < numTasks; i++)
+        if (tasks[i].proc->flg & PROC_ASM) {
+            genProc(tasks[i].proc);
+            tasks[i].code = cCode;
+        }
+
+    parallelFor(numTasks, genTask, NULL);
+
+    for (int i = 0; i < numTasks; i++)
+        writeProc(tasks[i].proc, &tasks[i].code, fp);
+
+    free(tasks);
+    tasks = NULL;
+    numTasks = allocTasks = 0;
+}
+
+/*
+ Recursive procedure. Displays the procedure's code in depth-first order of the call graph.
+ When the code is generated in parallel, the procedures are only queued in tasks in this order.
+*/
 static void backBackEnd(char *filename, PCALL_GRAPH pcallGraph, FILE *fp)
 {
     // Check if this procedure has been processed already
@@ -443,7 +524,16 @@ static void backBackEnd(char *filename, PCALL_GRAPH pcallGraph, FILE *fp)
             backBackEnd(filename, pcallGraph->outEdges[i], fp);
 
     // Generate code for this procedure
-    codeGen(pcallGraph->proc, fp);
+    if (option.numJobs > 1 && !option.verbose) {
+        if (numTasks == allocTasks) {
+            allocTasks = allocTasks ? allocTasks * 2 : 64;
+            tasks = allocVar(tasks, allocTasks * sizeof(GEN_TASK));
+        }
+        tasks[numTasks++].proc = pcallGraph->proc;
+    } else {
+        genProc(pcallGraph->proc);
+        writeProc(pcallGraph->proc, &cCode, fp);
+    }
 }
 
 // Invokes the necessary routines to produce code one procedure at a time.
@@ -472,6 +562,9 @@ void BackEnd(char *fileName, PCALL_GRAPH pcallGraph)
     // Process each procedure at a time
     backBackEnd(fileName, pcallGraph, fp);
 
+    if (numTasks > 0) // Queued to be generated in parallel
+        parallelCodeGen(fp);
+
     // Close output file
     fclose(fp);
     printf("%s: Finished writing C beta file\n", progname);
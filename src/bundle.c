@@ -17,29 +17,48 @@
  *
  */
 
-// Module that handles the bundle type (array of pointers to strings).
+// Module that handles the bundle type (tables of lines of text).
 
 #include "dcc.h"
 #include <stdarg.h>
 #include <stdlib.h>
 #include <string.h>
 
-#define deltaProcLines 20
+#define procLinesInit 64 // Initial # lines of a string table
 
 
 // Allocates memory for a new bundle and initializes it to zero.
 void newBundle(bundle *procCode)
 {
-    memset(&(procCode->decl), 0, sizeof(strTable));
-    memset(&(procCode->code), 0, sizeof(strTable));
+    memset(procCode, 0, sizeof(bundle));
 }
 
 
-// Increments the size of the table strTab by deltaProcLines and copies all the strings to the new table.
+// Doubles the number of lines allocated in the table strTab.
 static void incTableSize(strTable *strTab)
 {
-    strTab->allocLines += deltaProcLines;
-    strTab->str = allocVar(strTab->str, strTab->allocLines * sizeof(char *));
+    strTab->allocLines = strTab->allocLines ? strTab->allocLines * 2 : procLinesInit;
+    strTab->line = allocVar(strTab->line, strTab->allocLines * sizeof(int));
+    strTab->label = allocVar(strTab->label, strTab->allocLines * sizeof(int));
+    strTab->gotoLabel = allocVar(strTab->gotoLabel, strTab->allocLines * sizeof(int));
+}
+
+
+// Appends the new text (in vprintf style) to the string sb, growing it as needed.
+static void vappendStrBuf(strBuf *sb, char *format, va_list args)
+{
+    va_list args2;
+    va_copy(args2, args);
+    int n = vsnprintf(NULL, 0, format, args2);
+    va_end(args2);
+
+    if (sb->len + n + 1 > sb->alloc) {
+        sb->alloc = (sb->len + n + 1 > sb->alloc * 2) ? sb->len + n + 1 : sb->alloc * 2;
+        sb->str = allocVar(sb->str, sb->alloc);
+    }
+
+    vsprintf(sb->str + sb->len, format, args);
+    sb->len += n;
 }
 
 
@@ -53,13 +72,11 @@ void appendStrTab(strTable *strTab, char *format, ...)
         incTableSize(strTab);
     }
 
-    strTab->str[strTab->numLines] = malloc(lineSize * sizeof(char));
-
-    if (strTab->str == NULL) {
-        fatalError(MALLOC_FAILED, lineSize * sizeof(char));
-    }
-
-    vsprintf(strTab->str[strTab->numLines], format, args);
+    strTab->line[strTab->numLines] = strTab->text.len;
+    strTab->label[strTab->numLines] = 0;
+    strTab->gotoLabel[strTab->numLines] = 0;
+    vappendStrBuf(&strTab->text, format, args);
+    strTab->text.len++; // Keep the line's terminator
     strTab->numLines++;
     va_end(args);
 }
@@ -72,45 +89,95 @@ int nextBundleIdx(strTable *strTab)
 }
 
 
-// Adds the given label to the start of the line strTab[idx].
-// The first tab is removed and replaced by this label
+/*
+ Adds the given label to the start of the line strTab[idx]. The first tab is removed and replaced
+ by this label when the line is written; the line itself is not copied. A line labelled twice
+ gets the new label in place of the first tab of the line as labelled before.
+*/
 void addLabelBundle(strTable *strTab, int idx, int label)
 {
-    char s[lineSize];
+    if (strTab->numLineLabels == strTab->allocLineLabels) {
+        strTab->allocLineLabels = strTab->allocLineLabels ? strTab->allocLineLabels * 2 : 16;
+        strTab->labels = allocVar(strTab->labels, strTab->allocLineLabels * sizeof(lineLabel));
+    }
+    strTab->labels[strTab->numLineLabels].label = label;
+    strTab->labels[strTab->numLineLabels].prev = strTab->label[idx];
+    strTab->label[idx] = ++strTab->numLineLabels;
+}
+
+
+// Makes the last line of strTab, its indentation, a goto to the given label.
+void addGotoBundle(strTable *strTab, int label)
+{
+    strTab->gotoLabel[strTab->numLines - 1] = label;
+}
+
+
+// Replaces the first tab of the line in *cur by the label e and the labels added before it
+static void applyLabels(strBuf **cur, strBuf **tmp, strTable *strTab, int e, int labelBase)
+{
+    if (e == 0)
+        return;
+
+    applyLabels(cur, tmp, strTab, strTab->labels[e - 1].prev, labelBase);
+    truncStrBuf(*tmp, 0);
+    appendStrBuf(*tmp, "l%d: %s", strTab->labels[e - 1].label + labelBase,
+                 ((*cur)->len >= 4) ? (*cur)->str + 4 : "");
 
-    sprintf(s, "l%d: %s", label, &strTab->str[idx][4]);
-    strcpy(strTab->str[idx], s);
+    strBuf *t = *cur;
+    *cur = *tmp;
+    *tmp = t;
 }
 
 
-// Writes the contents of the string table on the file fp.
-static void writeStrTab(FILE *fp, strTable strTab)
+// Writes the contents of the string table on the file fp, numbering its labels from labelBase.
+static void writeStrTab(FILE *fp, strTable *strTab, int labelBase)
 {
-    for (int i = 0; i < strTab.numLines; i++)
-        fprintf(fp, "%s", strTab.str[i]);
+    static strBuf s1, s2; // Labelled line
+    strBuf *cur = &s1, *tmp = &s2;
+
+    for (int i = 0; i < strTab->numLines; i++) {
+        char *s = strTab->text.str + strTab->line[i];
+
+        if (strTab->label[i] == 0 && strTab->gotoLabel[i] == 0) {
+            fputs(s, fp);
+            continue;
+        }
+
+        truncStrBuf(cur, 0);
+        appendStrBuf(cur, "%s", s);
+        if (strTab->gotoLabel[i] != 0)
+            appendStrBuf(cur, "goto L%d;\n", strTab->gotoLabel[i] + labelBase);
+        applyLabels(&cur, &tmp, strTab, strTab->label[i], labelBase);
+        fputs(cur->str, fp);
+    }
 }
 
 
-// Writes the contents of the bundle (procedure code and declaration) to a file.
-void writeBundle(FILE *fp, bundle procCode)
+/*
+ Writes the contents of the bundle (procedure code and declaration) to a file. The labels of the
+ code are numbered from labelBase + 1.
+*/
+void writeBundle(FILE *fp, bundle procCode, int labelBase)
 {
-    writeStrTab(fp, procCode.decl);
+    writeStrTab(fp, &procCode.decl, labelBase);
 
-    if (procCode.decl.str[procCode.decl.numLines - 1][0] != ' ')
+    if (procCode.decl.text.str[procCode.decl.line[procCode.decl.numLines - 1]] != ' ')
         fprintf(fp, "\n");
 
-    writeStrTab(fp, procCode.code);
+    writeStrTab(fp, &procCode.code, labelBase);
 }
 
 
-// Frees the storage allocated by the string table.
+// Frees the storage allocated by the string table, all lines at once.
 static void freeStrTab(strTable *strTab)
 {
     if (strTab->allocLines > 0) {
-        for (int i = 0; i < strTab->numLines; i++)
-            free(strTab->str[i]);
-
-        free(strTab->str);
+        free(strTab->line);
+        free(strTab->label);
+        free(strTab->gotoLabel);
+        free(strTab->labels);
+        free(strTab->text.str);
         memset(strTab, 0, sizeof(strTable));
     }
 }
@@ -122,3 +189,21 @@ void freeBundle(bundle *procCode)
     freeStrTab(&(procCode->decl));
     freeStrTab(&(procCode->code));
 }
+
+
+// Appends the new text (in printf style) to the string sb, growing it as needed.
+void appendStrBuf(strBuf *sb, char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    vappendStrBuf(sb, format, args);
+    va_end(args);
+}
+
+
+// Cuts the string sb back to its first len characters; 0 empties it for reuse.
+void truncStrBuf(strBuf *sb, int len)
+{
+    sb->len = len;
+    appendStrBuf(sb, ""); // Terminates str, allocating it if need be
+}
@@ -20,29 +20,54 @@
  *
  */
 
-// Module to handle the bundle type (array of pointers to strings).
+// Module to handle the bundle type (tables of lines of text).
 
 #include <stdio.h>
 
+// Growable string, appended to in printf style
 typedef struct {
-    int numLines;   // Number of lines in the table
-    int allocLines; // Number of lines allocated in the table
-    char **str;     // Table of strings
+    char *str; // Contents, NUL terminated
+    int len;   // Length of str
+    int alloc; // Bytes allocated for str
+} strBuf;
+
+// Label added to a line of a string table
+typedef struct {
+    int label; // Label number, relative to the bundle's first label
+    int prev;  // Label added to the line before this one (index + 1), 0 if none
+} lineLabel;
+
+/*
+ Table of lines, stored one after the other in a single text buffer. Label numbers are kept
+ apart from the text, so that they can be numbered when the table is written.
+*/
+typedef struct {
+    int numLines;       // Number of lines in the table
+    int allocLines;     // Number of lines allocated in the table
+    int *line;          // Offset of each line in text
+    int *label;         // Last label added to each line (index + 1 into labels), 0 if none
+    int *gotoLabel;     // Label that each goto line jumps to, 0 for other lines
+    strBuf text;        // Text of the lines, each one NUL terminated
+    lineLabel *labels;  // Labels added to lines
+    int numLineLabels;  // Number of labels in labels
+    int allocLineLabels; // Number of labels allocated in labels
 } strTable;
 
 typedef struct {
     strTable decl; // Declarations
     strTable code; // C code
+    int numLabels; // Number of labels used by code, numbered from 1
 } bundle;
 
-#define lineSize 360 // 3 lines in the mean time */
-
 void newBundle(bundle *procCode);
 void appendStrTab(strTable *strTab, char *format, ...);
 int nextBundleIdx(strTable *strTab);
 void addLabelBundle(strTable *strTab, int idx, int label);
-void writeBundle(FILE *fp, bundle procCode);
+void addGotoBundle(strTable *strTab, int label);
+void writeBundle(FILE *fp, bundle procCode, int labelBase);
 void freeBundle(bundle *procCode);
+void appendStrBuf(strBuf *sb, char *format, ...);
+void truncStrBuf(strBuf *sb, int len);
 
 #endif // BUNDLE_H
 
@@ -31,6 +31,12 @@ typedef struct list {
 } nodeList;
 
 
+// Sets of nodes of a procedure, with a bit per node by dfsLast index
+#define SET_WORDS(n) (((n) + 31) >> 5) // # words of a set of n nodes
+#define inSet(s, n) (((s)[(n) >> 5] >> ((n)&31)) & 1)
+#define addSet(s, n) ((s)[(n) >> 5] |= (uint32_t)1 << ((n)&31))
+
+
 #define ancestor(a, b) ((a->dfsLastNum < b->dfsLastNum) && (a->dfsFirstNum < b->dfsFirstNum))
 /* there is a path on the DFST from a to b if the a was first visited in a dfs,
    and a was later visited than b when doing the last visit of each node. */
@@ -50,49 +56,6 @@ static bool isBackEdge(PBB p, PBB s)
     return false;
 }
 
-/*
- Finds the common dominator of the current immediate dominator currImmDom
- and its predecessor's immediate dominator predImmDom
-*/
-static int commonDom(int currImmDom, int predImmDom, PPROC pProc)
-{
-    if (currImmDom == NO_DOM)
-        return predImmDom;
-
-    if (predImmDom == NO_DOM) // predecessor is the root
-        return currImmDom;
-
-    while ((currImmDom != NO_DOM) && (predImmDom != NO_DOM) && (currImmDom != predImmDom)) {
-        if (currImmDom < predImmDom)
-            predImmDom = pProc->dfsLast[predImmDom]->immedDom;
-        else
-            currImmDom = pProc->dfsLast[currImmDom]->immedDom;
-    }
-
-    return currImmDom;
-}
-
-/*
- Finds the immediate dominator of each node in the graph pProc->cfg.
- Adapted version of the dominators algorithm by Hecht and Ullman;
- finds immediate dominators only.
- Note: graph should be reducible
-*/
-static void findImmedDom(PPROC pProc)
-{
-    for (int currIdx = 0; currIdx < pProc->numBBs; currIdx++) {
-        PBB currNode = pProc->dfsLast[currIdx];
-        if (currNode->flg & INVALID_BB) // Do not process invalid BBs
-            continue;
-
-        for (int j = 0; j < currNode->numInEdges; j++) {
-            int predIdx = currNode->inEdges[j]->dfsLastNum;
-            if (predIdx < currIdx)
-                currNode->immedDom = commonDom(currNode->immedDom, predIdx, pProc);
-        }
-    }
-}
-
 // Inserts the node n to the list l.
 static void insertList(nodeList **l, int n)
 {
@@ -116,53 +79,31 @@ static bool inList(nodeList *l, int n)
     return false;
 }
 
-// Frees space allocated by the list l.
-static void freeList(nodeList **l)
-{
-    nodeList *next;
-
-    if (*l) {
-        next = (*l)->next;
-        free(*l);
-        *l = next;
-    }
-
-    *l = NULL;
-}
-
-// Returns whether the node n belongs to the queue list q.
-static bool inInt(PBB n, queue *q)
-{
-    while (q)
-        if (q->node == n)
-            return true;
-        else
-            q = q->next;
-
-    return false;
-}
-
-// Flags nodes that belong to the loop determined by (latchNode, head) and determines the type of loop.
-static void findNodesInLoop(PBB latchNode, PBB head, PPROC pProc, queue *intNodes)
+/*
+ Flags nodes that belong to the loop determined by (latchNode, head) and determines the type of
+ loop. intSet holds the nodes of the interval of head; loopSet is filled with the nodes of the loop.
+*/
+static void findNodesInLoop(PBB latchNode, PBB head, PPROC pProc, uint32_t *intSet,
+                            uint32_t *loopSet)
 {
     int i, headDfsNum, intNodeType;
-    nodeList *loopNodes = NULL;
-    int immedDom,         // dfsLast index to immediate dominator
-        thenDfs, elseDfs; // dsfLast index for THEN and ELSE nodes
-    PBB pbb;
+    int immedDom;           // dfsLast index to immediate dominator
+    PBB thenNode, elseNode; // THEN and ELSE nodes
+    bool thenDom, elseDom;  // THEN (ELSE) node dominates the latching node, from head on
 
     // Flag nodes in loop headed by head (except header node)
     headDfsNum = head->dfsLastNum;
     head->loopHead = headDfsNum;
-    insertList(&loopNodes, headDfsNum);
+    memset(loopSet, 0, SET_WORDS(pProc->numBBs) * sizeof(uint32_t));
+    addSet(loopSet, headDfsNum);
 
     for (i = headDfsNum + 1; i < latchNode->dfsLastNum; i++) {
         if (pProc->dfsLast[i]->flg & INVALID_BB) // skip invalid BBs
             continue;
 
         immedDom = pProc->dfsLast[i]->immedDom;
-        if (inList(loopNodes, immedDom) && inInt(pProc->dfsLast[i], intNodes)) {
-            insertList(&loopNodes, i);
+        if ((immedDom != NO_DOM) && inSet(loopSet, immedDom) && inSet(intSet, i)) {
+            addSet(loopSet, i);
             if (pProc->dfsLast[i]->loopHead == NO_NODE) // not in other loop
                 pProc->dfsLast[i]->loopHead = headDfsNum;
         }
@@ -171,15 +112,15 @@ static void findNodesInLoop(PBB latchNode, PBB head, PPROC pProc, queue *intNode
     latchNode->loopHead = headDfsNum;
 
     if (latchNode != head)
-        insertList(&loopNodes, latchNode->dfsLastNum);
+        addSet(loopSet, latchNode->dfsLastNum);
 
     // Determine type of loop and follow node
     intNodeType = head->nodeType;
 
     if (latchNode->nodeType == TWO_BRANCH)
         if ((intNodeType == TWO_BRANCH) || (latchNode == head))
-            if ((latchNode == head) || (inList(loopNodes, head->edges[THEN].BBptr->dfsLastNum) &&
-                                        inList(loopNodes, head->edges[ELSE].BBptr->dfsLastNum))) {
+            if ((latchNode == head) || (inSet(loopSet, head->edges[THEN].BBptr->dfsLastNum) &&
+                                        inSet(loopSet, head->edges[ELSE].BBptr->dfsLastNum))) {
                 head->loopType = REPEAT_TYPE;
                 if (latchNode->edges[0].BBptr == head)
                     head->loopFollow = latchNode->edges[ELSE].BBptr->dfsLastNum;
@@ -188,7 +129,7 @@ static void findNodesInLoop(PBB latchNode, PBB head, PPROC pProc, queue *intNode
                 pProc->Icode.icode[latchNode->start + latchNode->length - 1].ll.flg |= JX_LOOP;
             } else {
                 head->loopType = WHILE_TYPE;
-                if (inList(loopNodes, head->edges[THEN].BBptr->dfsLastNum))
+                if (inSet(loopSet, head->edges[THEN].BBptr->dfsLastNum))
                     head->loopFollow = head->edges[ELSE].BBptr->dfsLastNum;
                 else
                     head->loopFollow = head->edges[THEN].BBptr->dfsLastNum;
@@ -208,50 +149,53 @@ static void findNodesInLoop(PBB latchNode, PBB head, PPROC pProc, queue *intNode
         head->loopFollow = latchNode->edges[0].BBptr->dfsLastNum;
     } else if (intNodeType == TWO_BRANCH) {
         head->loopType = WHILE_TYPE;
-        pbb = latchNode;
-        thenDfs = head->edges[THEN].BBptr->dfsLastNum;
-        elseDfs = head->edges[ELSE].BBptr->dfsLastNum;
-
-        while (1) {
-            if (pbb->dfsLastNum == thenDfs) {
-                head->loopFollow = elseDfs;
-                break;
-            } else if (pbb->dfsLastNum == elseDfs) {
-                head->loopFollow = thenDfs;
-                break;
-            }
+        thenNode = head->edges[THEN].BBptr;
+        elseNode = head->edges[ELSE].BBptr;
+
+        /* The branch that leads to the latching node dominates it; the follow is the other one.
+           The head dominates the nodes of its interval, so only dominators from it count. If
+           both branches dominate the latching node, the nearest one is taken. */
+        thenDom = dominates(thenNode, latchNode) && (thenNode->dfsLastNum >= head->dfsLastNum);
+        elseDom = dominates(elseNode, latchNode) && (elseNode->dfsLastNum >= head->dfsLastNum);
+        if (thenDom && elseDom) {
+            if (thenNode->dfsLastNum > elseNode->dfsLastNum)
+                elseDom = false;
+            else
+                thenDom = false;
+        }
 
-            /* Check if couldn't find it, then it is a strangely formed
+        if (thenDom)
+            head->loopFollow = elseNode->dfsLastNum;
+        else if (elseDom)
+            head->loopFollow = thenNode->dfsLastNum;
+        else {
+            /* Couldn't find it, then it is a strangely formed
                loop, so it is safer to consider it an endless loop */
-            if (pbb->dfsLastNum <= head->dfsLastNum) {
-                head->loopType = ENDLESS_TYPE;
-                // missing follow
-                break;
-            }
-            pbb = pProc->dfsLast[pbb->immedDom];
+            head->loopType = ENDLESS_TYPE;
+            // missing follow
         }
-        if (pbb->dfsLastNum > head->dfsLastNum)
+
+        if ((thenDom && (thenNode->dfsLastNum > head->dfsLastNum)) ||
+            (elseDom && (elseNode->dfsLastNum > head->dfsLastNum)))
             pProc->dfsLast[head->loopFollow]->loopHead = NO_NODE;
         pProc->Icode.icode[head->start + head->length - 1].ll.flg |= JX_LOOP;
     } else {
         head->loopType = ENDLESS_TYPE;
         // missing follow
     }
-
-    freeList(&loopNodes);
 }
 
-// Recursive procedure to find nodes that belong to the interval (ie. nodes from G1).
-static void findNodesInInt(queue **intNodes, int level, interval *Ii)
+// Recursive procedure to add the nodes that belong to the interval (ie. nodes from G1) to intSet.
+static void findNodesInInt(uint32_t *intSet, int level, interval *Ii)
 {
     queue *l;
 
     if (level == 1)
         for (l = Ii->nodes; l; l = l->next)
-            appendQueue(intNodes, l->node);
+            addSet(intSet, l->node->dfsLastNum);
     else
         for (l = Ii->nodes; l; l = l->next)
-            findNodesInInt(intNodes, level - 1, l->node->correspInt);
+            findNodesInInt(intSet, level - 1, l->node->correspInt);
 }
 
 // Algorithm for structuring loops
@@ -264,7 +208,12 @@ static void structLoops(PPROC pProc, derSeq *derivedG)
     int i,             // counter
         level = 0;     // derived sequence level
     interval *initInt; // initial interval
-    queue *intNodes;   // list of interval nodes
+    uint32_t *intSet,  // set of interval nodes
+        *loopSet;      // set of loop nodes, see findNodesInLoop
+
+    // The sets are reused for all the intervals
+    intSet = allocMem(SET_WORDS(pProc->numBBs) * sizeof(uint32_t));
+    loopSet = allocMem(SET_WORDS(pProc->numBBs) * sizeof(uint32_t));
 
     // Structure loops
     while (derivedG) { // for all derived sequences Gi
@@ -272,21 +221,21 @@ static void structLoops(PPROC pProc, derSeq *derivedG)
         Ii = derivedG->Ii;
         while (Ii) {   // for all intervals Ii of Gi
             latchNode = NULL;
-            intNodes = NULL;
+            memset(intSet, 0, SET_WORDS(pProc->numBBs) * sizeof(uint32_t));
 
-            // Find interval head (original BB node in G1) and createlist of nodes of interval Ii.
+            // Find interval head (original BB node in G1) and create set of nodes of interval Ii.
             initInt = Ii;
             for (i = 1; i < level; i++)
                 initInt = initInt->nodes->node->correspInt;
             intHead = initInt->nodes->node;
 
             // Find nodes that belong to the interval (nodes from G1)
-            findNodesInInt(&intNodes, level, Ii);
+            findNodesInInt(intSet, level, Ii);
 
             // Find greatest enclosing back edge (if any)
             for (i = 0; i < intHead->numInEdges; i++) {
                 pred = intHead->inEdges[i];
-                if (inInt(pred, intNodes) && isBackEdge(pred, intHead)) {
+                if (inSet(intSet, pred->dfsLastNum) && isBackEdge(pred, intHead)) {
                     if (!latchNode)
                         latchNode = pred;
                     else {
@@ -303,7 +252,7 @@ static void structLoops(PPROC pProc, derSeq *derivedG)
                 if ((latchNode->caseHead == intHead->caseHead) &&
                     (latchNode->loopHead == NO_NODE)) {
                     intHead->latchNode = latchNode->dfsLastNum;
-                    findNodesInLoop(latchNode, intHead, pProc, intNodes);
+                    findNodesInLoop(latchNode, intHead, pProc, intSet, loopSet);
                     latchNode->flg |= IS_LATCH_NODE;
                 }
             }
@@ -313,6 +262,9 @@ static void structLoops(PPROC pProc, derSeq *derivedG)
         // Next derived sequence
         derivedG = derivedG->next;
     }
+
+    free(intSet);
+    free(loopSet);
 }
 
 /*
@@ -363,8 +315,8 @@ static void structCases(PPROC pProc)
 
             /* Find descendant node which has as immediate predecessor
                the current header node, and is not a successor. */
-            for (int j = i + 2; j < pProc->numBBs; j++) {
-                if ((!successor(j, i, pProc)) && (pProc->dfsLast[j]->immedDom == i)) {
+            for (int j = caseHeader->domChild; j != NO_DOM; j = pProc->dfsLast[j]->domSibling) {
+                if ((j >= i + 2) && (!successor(j, i, pProc))) {
                     if (exitNode == NO_NODE)
                         exitNode = j;
                     else if (pProc->dfsLast[exitNode]->numInEdges < pProc->dfsLast[j]->numInEdges)
@@ -401,13 +353,12 @@ static void flagNodes(nodeList **l, int f, PPROC pProc)
 // Structures if statements
 static void structIfs(PPROC pProc)
 {
-    int curr,                 // Index for linear scan of nodes
-        desc,                 // Index for descendant
-        followInEdges,        // Largest # in-edges so far
-        follow;               // Possible follow node
-    nodeList *domDesc = NULL, // List of nodes dominated by curr
-        *unresolved = NULL;   // List of unresolved if nodes
-    PBB currNode,             // Pointer to current node
+    int curr,                   // Index for linear scan of nodes
+        desc,                   // Index for descendant
+        followInEdges,          // Largest # in-edges so far
+        follow;                 // Possible follow node
+    nodeList *unresolved = NULL; // List of unresolved if nodes
+    PBB currNode,               // Pointer to current node
         pbb;
 
     // Linear scan of nodes in reverse dfsLast order
@@ -422,14 +373,11 @@ static void structIfs(PPROC pProc)
             follow = 0;
 
             // Find all nodes that have this node as immediate dominator
-            for (desc = curr + 1; desc < pProc->numBBs; desc++) {
-                if (pProc->dfsLast[desc]->immedDom == curr) {
-                    insertList(&domDesc, desc);
-                    pbb = pProc->dfsLast[desc];
-                    if ((pbb->numInEdges - pbb->numBackEdges) > followInEdges) {
-                        follow = desc;
-                        followInEdges = pbb->numInEdges - pbb->numBackEdges;
-                    }
+            for (desc = currNode->domChild; desc != NO_DOM; desc = pbb->domSibling) {
+                pbb = pProc->dfsLast[desc];
+                if ((pbb->numInEdges - pbb->numBackEdges) > followInEdges) {
+                    follow = desc;
+                    followInEdges = pbb->numInEdges - pbb->numBackEdges;
                 }
             }
 
@@ -441,7 +389,6 @@ static void structIfs(PPROC pProc)
             } else
                 insertList(&unresolved, curr);
         }
-        freeList(&domDesc);
     }
 }
 
@@ -479,8 +426,8 @@ void compoundCond(PPROC pproc)
                     // Construct compound DBL_OR expression
                     picode = &pproc->Icode.icode[pbb->start + pbb->length - 1];
                     ticode = &pproc->Icode.icode[t->start + t->length - 1];
-                    exp = boolCondExp(picode->hl.oper.exp, ticode->hl.oper.exp, DBL_OR);
-                    picode->hl.oper.exp = exp;
+                    exp = boolCondExp(icodeHl(picode).oper.exp, icodeHl(ticode).oper.exp, DBL_OR);
+                    icodeHl(picode).oper.exp = exp;
 
                     // Replace in-edge to obb from t to pbb
                     for (j = 0; j < obb->numInEdges; j++)
@@ -508,8 +455,8 @@ void compoundCond(PPROC pproc)
                         i--; // to repeat this analysis
 
                     // Update statistics
-                    stats.numBBaft--;
-                    stats.numEdgesAft -= 2;
+                    pproc->stats.numBBaft--;
+                    pproc->stats.numEdgesAft -= 2;
                     change = true;
                 }
 
@@ -521,9 +468,9 @@ void compoundCond(PPROC pproc)
                     // Construct compound DBL_AND expression
                     picode = &pproc->Icode.icode[pbb->start + pbb->length - 1];
                     ticode = &pproc->Icode.icode[t->start + t->length - 1];
-                    inverseCondOp(&picode->hl.oper.exp);
-                    exp = boolCondExp(picode->hl.oper.exp, ticode->hl.oper.exp, DBL_AND);
-                    picode->hl.oper.exp = exp;
+                    inverseCondOp(&icodeHl(picode).oper.exp);
+                    exp = boolCondExp(icodeHl(picode).oper.exp, icodeHl(ticode).oper.exp, DBL_AND);
+                    icodeHl(picode).oper.exp = exp;
 
                     // Replace in-edge to obb from t to pbb
                     for (j = 0; j < obb->numInEdges; j++)
@@ -552,8 +499,8 @@ void compoundCond(PPROC pproc)
                         i--; // to repeat this analysis
 
                     // Update statistics
-                    stats.numBBaft--;
-                    stats.numEdgesAft -= 2;
+                    pproc->stats.numBBaft--;
+                    pproc->stats.numEdgesAft -= 2;
                     change = true;
                 }
 
@@ -565,8 +512,8 @@ void compoundCond(PPROC pproc)
                     // Construct compound DBL_AND expression
                     picode = &pproc->Icode.icode[pbb->start + pbb->length - 1];
                     ticode = &pproc->Icode.icode[t->start + t->length - 1];
-                    exp = boolCondExp(picode->hl.oper.exp, ticode->hl.oper.exp, DBL_AND);
-                    picode->hl.oper.exp = exp;
+                    exp = boolCondExp(icodeHl(picode).oper.exp, icodeHl(ticode).oper.exp, DBL_AND);
+                    icodeHl(picode).oper.exp = exp;
 
                     // Replace in-edge to obb from e to pbb
                     for (j = 0; j < obb->numInEdges; j++)
@@ -594,8 +541,8 @@ void compoundCond(PPROC pproc)
                         i--; // to repeat this analysis
 
                     // Update statistics
-                    stats.numBBaft--;
-                    stats.numEdgesAft -= 2;
+                    pproc->stats.numBBaft--;
+                    pproc->stats.numEdgesAft -= 2;
                     change = true;
                 }
 
@@ -607,9 +554,9 @@ void compoundCond(PPROC pproc)
                     // Construct compound DBL_OR expression
                     picode = &pproc->Icode.icode[pbb->start + pbb->length - 1];
                     ticode = &pproc->Icode.icode[t->start + t->length - 1];
-                    inverseCondOp(&picode->hl.oper.exp);
-                    exp = boolCondExp(picode->hl.oper.exp, ticode->hl.oper.exp, DBL_OR);
-                    picode->hl.oper.exp = exp;
+                    inverseCondOp(&icodeHl(picode).oper.exp);
+                    exp = boolCondExp(icodeHl(picode).oper.exp, icodeHl(ticode).oper.exp, DBL_OR);
+                    icodeHl(picode).oper.exp = exp;
 
                     // Replace in-edge to obb from e to pbb
                     for (j = 0; j < obb->numInEdges; j++)
@@ -638,8 +585,8 @@ void compoundCond(PPROC pproc)
                         i--; // to repeat this analysis
 
                     // Update statistics
-                    stats.numBBaft--;
-                    stats.numEdgesAft -= 2;
+                    pproc->stats.numBBaft--;
+                    pproc->stats.numEdgesAft -= 2;
                     change = true;
                 }
             }
@@ -650,8 +597,8 @@ void compoundCond(PPROC pproc)
 // Structuring algorithm to find the structures of the graph pProc->cfg
 void structure(PPROC pProc, derSeq *derivedG)
 {
-    // Find immediate dominators of the graph
-    findImmedDom(pProc);
+    // Find the dominator tree of the graph
+    findDominators(pProc);
 
     if (pProc->hasCase)
         structCases(pProc);
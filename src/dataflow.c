@@ -21,6 +21,7 @@
 
 #include "dcc.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 
@@ -86,8 +87,8 @@ static void elimCondCodes(PPROC pProc)
                                 break;
 
                             case iOR:
-                                lhs =
-                                    copyCondExp(pProc->Icode.icode[defAt - 1].hl.oper.asgn.lhs);
+                                lhs = copyCondExp(
+                                    icodeHl(&pProc->Icode.icode[defAt - 1]).oper.asgn.lhs);
                                 copyDU(&pProc->Icode.icode[useAt - 1],
                                        &pProc->Icode.icode[defAt - 1], USE, DEF);
                                 if (pProc->Icode.icode[defAt - 1].ll.flg & B)
@@ -142,8 +143,8 @@ static void elimCondCodes(PPROC pProc)
                 if ((pBB->length == 1) && (pProc->Icode.icode[useAt - 1].ll.opcode >= iJB) &&
                     (pProc->Icode.icode[useAt - 1].ll.opcode <= iJNS)) {
                     prev = &pProc->Icode.icode[pBB->inEdges[0]->start + pBB->inEdges[0]->length - 1];
-                    if (prev->hl.opcode == JCOND) {
-                        exp = copyCondExp(prev->hl.oper.exp);
+                    if (icodeHl(prev).opcode == JCOND) {
+                        exp = copyCondExp(icodeHl(prev).oper.exp);
                         changeBoolCondExpOp(
                             exp, condOpJCond[pProc->Icode.icode[useAt - 1].ll.opcode - iJB]);
                         copyDU(&pProc->Icode.icode[useAt - 1], prev, USE, USE);
@@ -189,36 +190,132 @@ static void genLiveKtes(PPROC pproc)
     }
 }
 
-/*
- Generates the liveIn() and liveOut() sets for each basic block via an iterative approach.
- Propagates register usage information to the procedure call.
-*/
-static void liveRegAnalysis(PPROC pproc, uint32_t liveOut)
+// Live register analysis of a procedure in progress, see liveRegAnalysis
+typedef struct {
+    PPROC proc;           // Procedure
+    uint32_t liveOut;     // Registers live on return from the procedure
+    int *work;            // Basic blocks to process, as dfsLast indexes; NULL before starting
+    bool *queued;         // Whether each basic block is in work
+    int head;             // Index in work of the next basic block to process
+    int numWork;          // # basic blocks in work
+    int i;                // Basic block being processed, as dfsLast index
+    bool resume;          // Block i is waiting for the analysis of its callee
+    uint32_t prevLiveIn;  // liveIn of block i before it was processed
+} LIVE_FRAME;
+
+// Procedure in the data flow schedule, see dataFlow
+typedef struct {
+    PPROC proc;   // Procedure
+    int lowLink;  // Least index of the procedures of its component it is known to reach
+    bool onStack; // Its component is not complete yet
+    int scc;      // Its strongly connected component, -1 until complete
+} DF_NODE;
+
+// Strongly connected component of the call graph, ie. mutually recursive procedures
+typedef struct {
+    int first;    // Index of its first procedure in sccProcs
+    int numProcs; // # procedures
+    int level;    // Analysed after the components of lower levels, see levelScc
+} DF_SCC;
+
+// Data flow schedule. Indexes into node are the procedures' dfIdx, from 1.
+static struct {
+    DF_NODE *node;   // Procedures, in the order they were found
+    int numNodes;    // # procedures in node, plus 1
+    int allocNodes;  // # procedures allocated in node
+
+    LIVE_FRAME *live; // Procedures whose live register analysis is in progress
+    int numLive;      // # procedures in live
+    int allocLive;    // # procedures allocated in live
+
+    int *sccStk;     // Procedures analysed whose component is not complete yet
+    int numSccStk;   // # procedures in sccStk
+
+    DF_SCC *scc;     // Components, in the order they were completed (ie. callees first)
+    int numScc;      // # components in scc
+    int allocScc;    // # components allocated in scc
+    PPROC *sccProcs; // Procedures of each component, in the order their analysis finished
+    int numSccProcs; // # procedures in sccProcs
+    int *level;      // Components of each level, in the order they were completed
+} sched;
+
+// Returns the procedure invoked by the call basic block pbb, NULL if pbb is not a call
+static PPROC bbCallee(PPROC pproc, PBB pbb)
 {
-    PBB pbb;              // pointer to current basic block
-    PPROC pcallee;        // invoked subroutine
-    PICODE ticode,        // icode that invokes a subroutine
-           picode;        // icode of function return
-    uint32_t prevLiveOut, // previous live out
-             prevLiveIn;  // previous live in
+    if ((pbb->flg & INVALID_BB) || (pbb->nodeType != CALL_NODE))
+        return NULL;
 
-    // liveOut for this procedure
-    pproc->liveOut = liveOut;
+    return icodeHl(&pproc->Icode.icode[pbb->start + pbb->length - 1]).oper.call.proc;
+}
 
-    bool change = true;
- 
-    while (change) { // Process nodes in reverse postorder order
-        change = false;
+// Returns the index of the procedure in the data flow schedule, adding it if needed
+static int dfNode(PPROC pproc)
+{
+    if (pproc->dfIdx != 0)
+        return pproc->dfIdx;
+
+    if (sched.numNodes == sched.allocNodes) {
+        sched.allocNodes = sched.allocNodes ? sched.allocNodes * 2 : 64;
+        sched.node = allocVar(sched.node, sched.allocNodes * sizeof(DF_NODE));
+        sched.sccStk = allocVar(sched.sccStk, sched.allocNodes * sizeof(int));
+        sched.sccProcs = allocVar(sched.sccProcs, sched.allocNodes * sizeof(PPROC));
+    }
+
+    if (sched.numNodes == 0) // node[0] is not used
+        sched.numNodes = 1;
 
-        for (int i = pproc->numBBs; i > 0; i--) {
-            pbb = pproc->dfsLast[i - 1];
+    DF_NODE *n = &sched.node[sched.numNodes];
+    n->proc = pproc;
+    n->lowLink = sched.numNodes;
+    n->onStack = false;
+    n->scc = -1;
 
-            if (pbb->flg & INVALID_BB) // Do not process invalid BBs
-                continue;
+    return (pproc->dfIdx = sched.numNodes++);
+}
+
+/*
+ Generates the liveIn() and liveOut() sets for each basic block via an iterative approach. A
+ worklist holds the basic blocks to process: first all of them, then the predecessors of those
+ whose liveIn() changes. Propagates register usage information to the procedure call.
+ Returns the callee whose analysis is needed to go on, with the liveOut of the calling basic
+ block; the analysis goes on from this block when called again. Returns NULL once done.
+*/
+static PPROC liveRegAnalysis(LIVE_FRAME *f)
+{
+    PPROC pproc = f->proc; // procedure being analysed
+    PBB pbb;               // pointer to current basic block
+    PPROC pcallee;         // invoked subroutine
+    PICODE ticode,         // icode that invokes a subroutine
+           picode;         // icode of function return
+    uint32_t liveOut = f->liveOut; // liveOut for this procedure
+
+    if (!f->work) { // Start with all the nodes, in reverse postorder order
+        f->work = allocMem(pproc->numBBs * sizeof(int));
+        f->queued = allocMem(pproc->numBBs * sizeof(bool));
+        memset(f->queued, false, pproc->numBBs * sizeof(bool));
+        f->head = f->numWork = 0;
+        for (int i = pproc->numBBs - 1; i >= 0; i--)
+            if (!(pproc->dfsLast[i]->flg & INVALID_BB)) { // Do not process invalid BBs
+                f->work[f->numWork++] = i;
+                f->queued[i] = true;
+            }
+        pproc->stats.numLivePasses++;
+    }
 
-            // Get current liveIn() and liveOut() sets
-            prevLiveIn = pbb->liveIn;
-            prevLiveOut = pbb->liveOut;
+    while (f->resume || (f->numWork > 0)) {
+        if (f->resume) { // The callee of this block has just been analysed
+            pbb = pproc->dfsLast[f->i];
+            f->resume = false;
+        } else {
+            f->i = f->work[f->head];
+            f->head = (f->head + 1) % pproc->numBBs;
+            f->numWork--;
+            f->queued[f->i] = false;
+            pbb = pproc->dfsLast[f->i];
+            pproc->stats.numLiveVisits++;
+
+            // Get current liveIn() set
+            f->prevLiveIn = pbb->liveIn;
 
             // liveOut(b) = U LiveIn(s); where s is successor(b)
             // liveOut(b) = {liveOut}; when b is a RET node
@@ -228,9 +325,10 @@ static void liveRegAnalysis(PPROC pproc, uint32_t liveOut)
                 // Get return expression of function
                 if (pproc->flg & PROC_IS_FUNC) {
                     picode = &pproc->Icode.icode[pbb->start + pbb->length - 1];
-                    if (picode->hl.opcode == RET) {
-                        picode->hl.oper.exp = idCondExpID(&pproc->retVal, &pproc->localId,
-                                                             pbb->start + pbb->length - 1);
+                    if (icodeHl(picode).opcode == RET) {
+                        icodeHl(picode).oper.exp =
+                            idCondExpID(&pproc->retVal, &pproc->localId,
+                                        pbb->start + pbb->length - 1);
                         picode->du.use = liveOut;
                     }
                 }
@@ -238,54 +336,71 @@ static void liveRegAnalysis(PPROC pproc, uint32_t liveOut)
                 for (int j = 0; j < pbb->numOutEdges; j++)
                     pbb->liveOut |= pbb->edges[j].BBptr->liveIn;
 
-                // propagate to invoked procedure
-                if (pbb->nodeType == CALL_NODE) {
-                    ticode = &pproc->Icode.icode[pbb->start + pbb->length - 1];
-                    pcallee = ticode->hl.oper.call.proc;
-
-                    // user/runtime routine
-                    if (!(pcallee->flg & PROC_ISLIB)) {
-                        if (pcallee->liveAnal == false) // hasn't been processed
-                            dataFlow(pcallee, pbb->liveOut);
-                        pbb->liveOut = pcallee->liveIn;
-                    } else { /* library routine */
-                        if (pcallee->flg & PROC_IS_FUNC) // returns a value
-                            pbb->liveOut = pcallee->liveOut;
-                        else
-                            pbb->liveOut = 0;
-                    }
-
-                    switch (pcallee->retVal.type) {
-                    case TYPE_LONG_SIGN:
-                    case TYPE_LONG_UNSIGN:
-                        ticode->du1.numRegsDef = 2;
-                        break;
-                    case TYPE_WORD_SIGN:
-                    case TYPE_WORD_UNSIGN:
-                    case TYPE_BYTE_SIGN:
-                    case TYPE_BYTE_UNSIGN:
-                        ticode->du1.numRegsDef = 1;
-                        break;
-                    default:
-                        break;
-                    } // eos
-
-                    // Propagate du/use results to calling icode
-                    ticode->du.use = pcallee->liveIn;
-                    ticode->du.def = pcallee->liveOut;
+                // user/runtime routine that hasn't been processed
+                pcallee = bbCallee(pproc, pbb);
+                if (pcallee && !(pcallee->flg & PROC_ISLIB) && !pcallee->liveAnal) {
+                    f->resume = true;
+                    return pcallee;
                 }
             }
+        }
 
-            // liveIn(b) = liveUse(b) U (liveOut(b) - def(b)
-            pbb->liveIn = pbb->liveUse | (pbb->liveOut & ~pbb->def);
+        // propagate to invoked procedure
+        if ((pbb->numOutEdges != 0) && (pbb->nodeType == CALL_NODE)) {
+            ticode = &pproc->Icode.icode[pbb->start + pbb->length - 1];
+            pcallee = icodeHl(ticode).oper.call.proc;
+
+            // user/runtime routine
+            if (!(pcallee->flg & PROC_ISLIB))
+                pbb->liveOut = pcallee->liveIn;
+            else { /* library routine */
+                if (pcallee->flg & PROC_IS_FUNC) // returns a value
+                    pbb->liveOut = pcallee->liveOut;
+                else
+                    pbb->liveOut = 0;
+            }
 
-            // Check if live sets have been modified
-            if ((prevLiveIn != pbb->liveIn) || (prevLiveOut != pbb->liveOut))
-                change = true;
+            switch (pcallee->retVal.type) {
+            case TYPE_LONG_SIGN:
+            case TYPE_LONG_UNSIGN:
+                ticode->numRegsDef = 2;
+                break;
+            case TYPE_WORD_SIGN:
+            case TYPE_WORD_UNSIGN:
+            case TYPE_BYTE_SIGN:
+            case TYPE_BYTE_UNSIGN:
+                ticode->numRegsDef = 1;
+                break;
+            default:
+                break;
+            } // eos
+
+            // Propagate du/use results to calling icode
+            ticode->du.use = pcallee->liveIn;
+            ticode->du.def = pcallee->liveOut;
         }
+
+        // liveIn(b) = liveUse(b) U (liveOut(b) - def(b)
+        pbb->liveIn = pbb->liveUse | (pbb->liveOut & ~pbb->def);
+
+        // Predecessors need processing again if liveIn(b) has been modified
+        if (f->prevLiveIn != pbb->liveIn)
+            for (int j = 0; j < pbb->numInEdges; j++) {
+                int pred = pbb->inEdges[j]->dfsLastNum;
+
+                if (!f->queued[pred] && !(pbb->inEdges[j]->flg & INVALID_BB)) {
+                    f->work[(f->head + f->numWork++) % pproc->numBBs] = pred;
+                    f->queued[pred] = true;
+                }
+            }
     }
+    free(f->work);
+    free(f->queued);
+    f->work = NULL;
+    f->queued = NULL;
 
     // Propagate liveIn(b) to procedure header
+    pbb = pproc->dfsLast[0];
     if (pbb->liveIn != 0) // uses registers
         pproc->liveIn = pbb->liveIn;
 
@@ -299,18 +414,26 @@ static void liveRegAnalysis(PPROC pproc, uint32_t liveOut)
         pproc->liveIn &= maskDuReg[rDI];
         pbb->liveIn &= maskDuReg[rDI];
     }
+    return NULL;
 }
 
-// Generates the du chain of each instruction in a basic block
+/*
+ Generates the du chain of each instruction in a basic block. The chains are kept in
+ pProc->Icode.du1 until findExps has used them (see findSccExps).
+*/
 static void genDU1(PPROC pProc)
 {
     uint8_t regi;          // Register that was defined
     PICODE picode, ticode; // Current and target bb
+    DU1 *du1;              // Def/use chain of picode
     PBB pbb, tbb;          // Current and target basic block
 
     bool res;
     int useIdx;
 
+    size_t cb = pProc->Icode.numIcode * sizeof(DU1);
+    pProc->Icode.du1 = memset(allocMem(cb), 0, cb);
+
     // Traverse tree in dfsLast order
     for (int i = 0; i < pProc->numBBs; i++) {
         pbb = pProc->dfsLast[i];
@@ -324,6 +447,7 @@ static void genDU1(PPROC pProc)
 
         for (int j = pbb->start; j < lastInst; j++) {
             picode = &pProc->Icode.icode[j];
+            du1 = &icodeDu1(&pProc->Icode, picode);
 
             if (picode->type == HIGH_LEVEL) {
                 regi = 0;
@@ -332,7 +456,7 @@ static void genDU1(PPROC pProc)
                 for (int k = 0; k < INDEXBASE; k++) {
                     if ((picode->du.def & power2(k)) != 0) {
                         regi = k + 1; // defined register
-                        picode->du1.regi[defRegIdx] = regi;
+                        du1->regi[defRegIdx] = regi;
 
                         /* Check remaining instructions of the BB for all uses of register regi,
                            before any definitions of the register */
@@ -349,7 +473,7 @@ static void genDU1(PPROC pProc)
                                 if (ticode->type == HIGH_LEVEL) {
                                     // if used, get icode index
                                     if (ticode->du.use & duReg[regi])
-                                        picode->du1.idx[defRegIdx][useIdx++] = n;
+                                        du1->idx[defRegIdx][useIdx++] = n;
 
                                     // if defined, stop finding uses for this reg
                                     if (ticode->du.def & duReg[regi])
@@ -368,8 +492,8 @@ static void genDU1(PPROC pProc)
                         /* Find target icode for CALL icodes to procedures that are functions.
                            The target icode is in the next basic block (unoptimized code) or
                            somewhere else on optimized code. */
-                        if ((picode->hl.opcode == CALL) &&
-                            (picode->hl.oper.call.proc->flg & PROC_IS_FUNC)) {
+                        if ((icodeHl(picode).opcode == CALL) &&
+                            (icodeHl(picode).oper.call.proc->flg & PROC_IS_FUNC)) {
                             tbb = pbb->edges[0].BBptr;
                             useIdx = 0;
                             for (int n = tbb->start; n < tbb->start + tbb->length; n++) {
@@ -377,7 +501,7 @@ static void genDU1(PPROC pProc)
                                 if (ticode->type == HIGH_LEVEL) {
                                     // if used, get icode index
                                     if (ticode->du.use & duReg[regi])
-                                        picode->du1.idx[defRegIdx][useIdx++] = n;
+                                        du1->idx[defRegIdx][useIdx++] = n;
 
                                     // if defined, stop finding uses for this reg
                                     if (ticode->du.def & duReg[regi])
@@ -387,7 +511,8 @@ static void genDU1(PPROC pProc)
 
                             /* if not used in this basic block, check if the register is live out,
                                if so, make it the last definition of this register */
-                            if ((picode->du1.idx[defRegIdx][useIdx] == 0) && (tbb->liveOut & duReg[regi]))
+                            if ((du1->idx[defRegIdx][useIdx] == 0) &&
+                                (tbb->liveOut & duReg[regi]))
                                 picode->du.lastDefRegi |= duReg[regi];
                         }
 
@@ -395,27 +520,28 @@ static void genDU1(PPROC pProc)
                            then register is useless, thus remove it. Also check that this is not a return
                            from a library function (routines such as printf return an integer,
                            which is normally not taken into account by the programmer). */
-                        if ((picode->invalid == false) && (picode->du1.idx[defRegIdx][0] == 0) &&
+                        if ((picode->invalid == false) && (du1->idx[defRegIdx][0] == 0) &&
                             (!(picode->du.lastDefRegi & duReg[regi])) &&
-                            (!((picode->hl.opcode != CALL) &&
-                               (picode->hl.oper.call.proc->flg & PROC_ISLIB)))) {
+                            (!((icodeHl(picode).opcode != CALL) &&
+                               (icodeHl(picode).oper.call.proc->flg & PROC_ISLIB)))) {
                             if (!(pbb->liveOut & duReg[regi])) { // not liveOut
-                                res = removeDefRegi(regi, picode, defRegIdx + 1, &pProc->localId);
+                                res = removeDefRegi(regi, &pProc->Icode, picode, defRegIdx + 1,
+                                                   &pProc->localId);
 
                                 /* Backpatch any uses of this instruction, within the same BB,
                                    if the instruction was invalidated */
                                 if (res == true)
                                     for (int p = j; p > pbb->start; p--) {
                                         ticode = &pProc->Icode.icode[p - 1];
+                                        uint16_t *uses = icodeDu1(&pProc->Icode, ticode).idx[0];
                                         for (int n = 0; n < MAX_USES; n++) {
-                                            if (ticode->du1.idx[0][n] == j) {
+                                            if (uses[n] == j) {
                                                 if (n < MAX_USES - 1) {
-                                                    memmove(&ticode->du1.idx[0][n],
-                                                            &ticode->du1.idx[0][n + 1],
-                                                            (MAX_USES - n - 1) * sizeof(int));
+                                                    memmove(&uses[n], &uses[n + 1],
+                                                            (MAX_USES - n - 1) * sizeof(uint16_t));
                                                     n--;
                                                 }
-                                                ticode->du1.idx[0][MAX_USES - 1] = 0;
+                                                uses[MAX_USES - 1] = 0;
                                             }
                                         }
                                     }
@@ -425,7 +551,7 @@ static void genDU1(PPROC pProc)
                         defRegIdx++;
 
                         // Check if all defined registers have been processed
-                        if ((defRegIdx >= picode->du1.numRegsDef) || (defRegIdx == MAX_REGS_DEF))
+                        if ((defRegIdx >= picode->numRegsDef) || (defRegIdx == MAX_REGS_DEF))
                             break;
                     }
                 }
@@ -441,14 +567,14 @@ static void forwardSubs(COND_EXPR *lhs, COND_EXPR *rhs, PICODE picode, PICODE ti
         return;
 
     // Insert on rhs of ticode, if possible
-    bool res = insertSubTreeReg(rhs, &ticode->hl.oper.asgn.rhs,
+    bool res = insertSubTreeReg(rhs, &icodeHl(ticode).oper.asgn.rhs,
                                 locsym->id[lhs->expr.ident.idNode.regiIdx].id.regi, locsym);
 
     if (res) {
         invalidateIcode(picode);
         (*numHlIcodes)--;
     } else { // Try to insert it on lhs of ticode
-        res = insertSubTreeReg(rhs, &ticode->hl.oper.asgn.lhs,
+        res = insertSubTreeReg(rhs, &icodeHl(ticode).oper.asgn.lhs,
                                locsym->id[lhs->expr.ident.idNode.regiIdx].id.regi, locsym);
         if (res) {
             invalidateIcode(picode);
@@ -464,13 +590,13 @@ static void forwardSubsLong(int longIdx, COND_EXPR *exp, PICODE picode, PICODE t
         return;
 
     // Insert on rhs of ticode, if possible
-    bool res = insertSubTreeLongReg(exp, &ticode->hl.oper.asgn.rhs, longIdx);
+    bool res = insertSubTreeLongReg(exp, &icodeHl(ticode).oper.asgn.rhs, longIdx);
 
     if (res) {
         invalidateIcode(picode);
         (*numHlIcodes)--;
     } else { // Try to insert it on lhs of ticode
-        res = insertSubTreeLongReg(exp, &ticode->hl.oper.asgn.lhs, longIdx);
+        res = insertSubTreeLongReg(exp, &icodeHl(ticode).oper.asgn.lhs, longIdx);
         if (res) {
             invalidateIcode(picode);
             (*numHlIcodes)--;
@@ -562,6 +688,7 @@ static void findExps(PPROC pProc)
 {
     PICODE picode;       // Current icode
     PICODE ticode;       // Target icode
+    DU1 *du1;            // Def/use chain of picode
     PBB pbb;             // Current basic block
     COND_EXPR *exp;      // expression pointer - for POP and CALL
     COND_EXPR *lhs;      // exp ptr for return value of a CALL
@@ -586,39 +713,42 @@ static void findExps(PPROC pProc)
 
         for (int j = pbb->start; j < lastInst; j++) {
             picode = &pProc->Icode.icode[j];
+            du1 = &icodeDu1(&pProc->Icode, picode);
             if ((picode->type == HIGH_LEVEL) && (picode->invalid == false)) {
                 numHlIcodes++;
-                if (picode->du1.numRegsDef == 1) { // byte/word regs
+                if (picode->numRegsDef == 1) { // byte/word regs
                     /* Check for only one use of this register.  If this is
                        the last definition of the register in this BB, check
                        that it is not liveOut from this basic block */
-                    if ((picode->du1.idx[0][0] != 0) && (picode->du1.idx[0][1] == 0)) {
+                    if ((du1->idx[0][0] != 0) && (du1->idx[0][1] == 0)) {
                         /* Check that this register is not liveOut, if it
                            is the last definition of the register */
-                        regi = picode->du1.regi[0];
+                        regi = du1->regi[0];
 
                         // Check if we can forward substitute this register
-                        switch (picode->hl.opcode) {
+                        switch (icodeHl(picode).opcode) {
                         default: break;
                         case ASSIGN: // Replace rhs of current icode into target icode expression
-                            ticode = &pProc->Icode.icode[picode->du1.idx[0][0]];
+                            ticode = &pProc->Icode.icode[du1->idx[0][0]];
                             if ((picode->du.lastDefRegi & duReg[regi]) &&
-                                ((ticode->hl.opcode != CALL) && (ticode->hl.opcode != RET)))
+                                (icodeHl(ticode).opcode != CALL) && (icodeHl(ticode).opcode != RET))
                                 continue;
 
-                            if (xClear(picode->hl.oper.asgn.rhs, j, picode->du1.idx[0][0],
+                            if (xClear(icodeHl(picode).oper.asgn.rhs, j, du1->idx[0][0],
                                        lastInst, pProc)) {
-                                switch (ticode->hl.opcode) {
+                                switch (icodeHl(ticode).opcode) {
                                 case ASSIGN:
-                                    forwardSubs(picode->hl.oper.asgn.lhs, picode->hl.oper.asgn.rhs,
-                                                picode, ticode, &pProc->localId, &numHlIcodes);
+                                    forwardSubs(icodeHl(picode).oper.asgn.lhs,
+                                                icodeHl(picode).oper.asgn.rhs, picode, ticode,
+                                                &pProc->localId, &numHlIcodes);
                                     break;
 
                                 case JCOND:
                                 case PUSH:
                                 case RET:
-                                    res = insertSubTreeReg(picode->hl.oper.asgn.rhs, &ticode->hl.oper.exp,
-                                    pProc->localId.id[picode->hl.oper.asgn.lhs->expr.ident.idNode.regiIdx].id.regi, //TODO WTF?
+                                    res = insertSubTreeReg(icodeHl(picode).oper.asgn.rhs,
+                                                           &icodeHl(ticode).oper.exp,
+                                    pProc->localId.id[icodeHl(picode).oper.asgn.lhs->expr.ident.idNode.regiIdx].id.regi, //TODO WTF?
                                                            &pProc->localId);
                                     if (res) {
                                         invalidateIcode(picode);
@@ -638,15 +768,15 @@ static void findExps(PPROC pProc)
                             break;
 
                         case POP:
-                            ticode = &pProc->Icode.icode[picode->du1.idx[0][0]];
+                            ticode = &pProc->Icode.icode[du1->idx[0][0]];
                             if ((picode->du.lastDefRegi & duReg[regi]) &&
-                                ((ticode->hl.opcode != CALL) && (ticode->hl.opcode != RET)))
+                                (icodeHl(ticode).opcode != CALL) && (icodeHl(ticode).opcode != RET))
                                 continue;
 
                             exp = popExpStk(); // pop last exp pushed
-                            switch (ticode->hl.opcode) {
+                            switch (icodeHl(ticode).opcode) {
                             case ASSIGN:
-                                forwardSubs(picode->hl.oper.exp, exp, picode, ticode,
+                                forwardSubs(icodeHl(picode).oper.exp, exp, picode, ticode,
                                             &pProc->localId, &numHlIcodes);
                                 break;
 
@@ -654,9 +784,9 @@ static void findExps(PPROC pProc)
                             case PUSH:
                             case RET:
                                 res = insertSubTreeReg(
-                                    exp, &ticode->hl.oper.exp,
+                                    exp, &icodeHl(ticode).oper.exp,
                                     pProc->localId
-                                        .id[picode->hl.oper.exp->expr.ident.idNode.regiIdx]
+                                        .id[icodeHl(picode).oper.exp->expr.ident.idNode.regiIdx]
                                         .id.regi,
                                     &pProc->localId);
                                 if (res) {
@@ -670,18 +800,18 @@ static void findExps(PPROC pProc)
                             break;
 
                         case CALL:
-                            ticode = &pProc->Icode.icode[picode->du1.idx[0][0]];
-                            switch (ticode->hl.opcode) {
+                            ticode = &pProc->Icode.icode[du1->idx[0][0]];
+                            switch (icodeHl(ticode).opcode) {
                             default: break;
                             case ASSIGN:
-                                exp = idCondExpFunc(picode->hl.oper.call.proc,
-                                                    picode->hl.oper.call.args);
-                                res = insertSubTreeReg(exp, &ticode->hl.oper.asgn.rhs,
-                                                       picode->hl.oper.call.proc->retVal.id.regi,
+                                exp = idCondExpFunc(icodeHl(picode).oper.call.proc,
+                                                    icodeHl(picode).oper.call.args);
+                                res = insertSubTreeReg(exp, &icodeHl(ticode).oper.asgn.rhs,
+                                                       icodeHl(picode).oper.call.proc->retVal.id.regi,
                                                        &pProc->localId);
                                 if (!res)
-                                    insertSubTreeReg(exp, &ticode->hl.oper.asgn.lhs,
-                                                     picode->hl.oper.call.proc->retVal.id.regi,
+                                    insertSubTreeReg(exp, &icodeHl(ticode).oper.asgn.lhs,
+                                                     icodeHl(picode).oper.call.proc->retVal.id.regi,
                                                      &pProc->localId);
                                 //  HERE missing: 2 regs TODO
                                 invalidateIcode(picode);
@@ -690,18 +820,18 @@ static void findExps(PPROC pProc)
 
                             case PUSH:
                             case RET:
-                                exp = idCondExpFunc(picode->hl.oper.call.proc,
-                                                    picode->hl.oper.call.args);
-                                ticode->hl.oper.exp = exp;
+                                exp = idCondExpFunc(icodeHl(picode).oper.call.proc,
+                                                    icodeHl(picode).oper.call.args);
+                                icodeHl(ticode).oper.exp = exp;
                                 invalidateIcode(picode);
                                 numHlIcodes--;
                                 break;
 
                             case JCOND:
-                                exp = idCondExpFunc(picode->hl.oper.call.proc,
-                                                    picode->hl.oper.call.args);
-                                retVal = &picode->hl.oper.call.proc->retVal,
-                                res = insertSubTreeReg(exp, &ticode->hl.oper.exp,
+                                exp = idCondExpFunc(icodeHl(picode).oper.call.proc,
+                                                    icodeHl(picode).oper.call.args);
+                                retVal = &icodeHl(picode).oper.call.proc->retVal,
+                                res = insertSubTreeReg(exp, &icodeHl(ticode).oper.exp,
                                                        retVal->id.regi, &pProc->localId);
                                 if (res) // was substituted
                                 {
@@ -719,35 +849,38 @@ static void findExps(PPROC pProc)
                     }
                 }
 
-                else if (picode->du1.numRegsDef == 2) { // long regs
+                else if (picode->numRegsDef == 2) { // long regs
                     // Check for only one use of these registers
-                    if ((picode->du1.idx[0][0] != 0) && (picode->du1.idx[0][1] == 0) &&
-                        (picode->du1.idx[1][0] != 0) && (picode->du1.idx[1][1] == 0)) {
-                        switch (picode->hl.opcode) {
+                    if ((du1->idx[0][0] != 0) && (du1->idx[0][1] == 0) &&
+                        (du1->idx[1][0] != 0) && (du1->idx[1][1] == 0)) {
+                        // Registers of the long pair defined here
+                        uint32_t longRegs = duReg[du1->regi[0]] | duReg[du1->regi[1]];
+
+                        switch (icodeHl(picode).opcode) {
                         default: break;
                         case ASSIGN:
                             // Replace rhs of current icode into target icode expression
-                            if (picode->du1.idx[0][0] == picode->du1.idx[1][0]) {
-                                ticode = &pProc->Icode.icode[picode->du1.idx[0][0]];
-                                if ((picode->du.lastDefRegi & duReg[regi]) &&
-                                    ((ticode->hl.opcode != CALL) &&
-                                     (ticode->hl.opcode != RET)))
+                            if (du1->idx[0][0] == du1->idx[1][0]) {
+                                ticode = &pProc->Icode.icode[du1->idx[0][0]];
+                                if ((picode->du.lastDefRegi & longRegs) &&
+                                    ((icodeHl(ticode).opcode != CALL) &&
+                                     (icodeHl(ticode).opcode != RET)))
                                     continue;
 
-                                switch (ticode->hl.opcode) {
+                                switch (icodeHl(ticode).opcode) {
                                 default: break;
                                 case ASSIGN:
                                     forwardSubsLong(
-                                        picode->hl.oper.asgn.lhs->expr.ident.idNode.longIdx,
-                                        picode->hl.oper.asgn.rhs, picode, ticode, &numHlIcodes);
+                                        icodeHl(picode).oper.asgn.lhs->expr.ident.idNode.longIdx,
+                                        icodeHl(picode).oper.asgn.rhs, picode, ticode, &numHlIcodes);
                                     break;
 
                                 case JCOND:
                                 case PUSH:
                                 case RET:
                                     res = insertSubTreeLongReg(
-                                        picode->hl.oper.asgn.rhs, &ticode->hl.oper.exp,
-                                        picode->hl.oper.asgn.lhs->expr.ident.idNode.longIdx);
+                                        icodeHl(picode).oper.asgn.rhs, &icodeHl(ticode).oper.exp,
+                                        icodeHl(picode).oper.asgn.lhs->expr.ident.idNode.longIdx);
                                     if (res) {
                                         invalidateIcode(picode);
                                         numHlIcodes--;
@@ -764,26 +897,26 @@ static void findExps(PPROC pProc)
                             break;
 
                         case POP:
-                            if (picode->du1.idx[0][0] == picode->du1.idx[1][0]) {
-                                ticode = &pProc->Icode.icode[picode->du1.idx[0][0]];
-                                if ((picode->du.lastDefRegi & duReg[regi]) &&
-                                    ((ticode->hl.opcode != CALL) &&
-                                     (ticode->hl.opcode != RET)))
+                            if (du1->idx[0][0] == du1->idx[1][0]) {
+                                ticode = &pProc->Icode.icode[du1->idx[0][0]];
+                                if ((picode->du.lastDefRegi & longRegs) &&
+                                    ((icodeHl(ticode).opcode != CALL) &&
+                                     (icodeHl(ticode).opcode != RET)))
                                     continue;
 
                                 exp = popExpStk(); // pop last exp pushed
-                                switch (ticode->hl.opcode) {
+                                switch (icodeHl(ticode).opcode) {
                                 default: break;
                                 case ASSIGN:
                                     forwardSubsLong(
-                                        picode->hl.oper.exp->expr.ident.idNode.longIdx, exp,
+                                        icodeHl(picode).oper.exp->expr.ident.idNode.longIdx, exp,
                                         picode, ticode, &numHlIcodes);
                                     break;
                                 case JCOND:
                                 case PUSH:
                                     res = insertSubTreeLongReg(
-                                        exp, &ticode->hl.oper.exp,
-                                        picode->hl.oper.asgn.lhs->expr.ident.idNode.longIdx);
+                                        exp, &icodeHl(ticode).oper.exp,
+                                        icodeHl(picode).oper.asgn.lhs->expr.ident.idNode.longIdx);
                                     if (res) {
                                         invalidateIcode(picode);
                                         numHlIcodes--;
@@ -796,34 +929,34 @@ static void findExps(PPROC pProc)
                             break;
 
                         case CALL: // check for function return
-                            ticode = &pProc->Icode.icode[picode->du1.idx[0][0]];
-                            switch (ticode->hl.opcode) {
+                            ticode = &pProc->Icode.icode[du1->idx[0][0]];
+                            switch (icodeHl(ticode).opcode) {
                             default: break;
                             case ASSIGN:
-                                exp = idCondExpFunc(picode->hl.oper.call.proc,
-                                                    picode->hl.oper.call.args);
-                                ticode->hl.oper.asgn.lhs = idCondExpLong(
+                                exp = idCondExpFunc(icodeHl(picode).oper.call.proc,
+                                                    icodeHl(picode).oper.call.args);
+                                icodeHl(ticode).oper.asgn.lhs = idCondExpLong(
                                     &pProc->localId, DST, ticode, HIGH_FIRST, j, DEF, 1);
-                                ticode->hl.oper.asgn.rhs = exp;
+                                icodeHl(ticode).oper.asgn.rhs = exp;
                                 invalidateIcode(picode);
                                 numHlIcodes--;
                                 break;
 
                             case PUSH:
                             case RET:
-                                exp = idCondExpFunc(picode->hl.oper.call.proc,
-                                                    picode->hl.oper.call.args);
-                                ticode->hl.oper.exp = exp;
+                                exp = idCondExpFunc(icodeHl(picode).oper.call.proc,
+                                                    icodeHl(picode).oper.call.args);
+                                icodeHl(ticode).oper.exp = exp;
                                 invalidateIcode(picode);
                                 numHlIcodes--;
                                 break;
 
                             case JCOND:
-                                exp = idCondExpFunc(picode->hl.oper.call.proc,
-                                                    picode->hl.oper.call.args);
-                                retVal = &picode->hl.oper.call.proc->retVal;
+                                exp = idCondExpFunc(icodeHl(picode).oper.call.proc,
+                                                    icodeHl(picode).oper.call.args);
+                                retVal = &icodeHl(picode).oper.call.proc->retVal;
                                 res = insertSubTreeLongReg(
-                                    exp, &ticode->hl.oper.exp,
+                                    exp, &icodeHl(ticode).oper.exp,
                                     newLongRegId(&pProc->localId, retVal->type, retVal->id.longId.h,
                                                  retVal->id.longId.l, j));
                                 if (res) { // was substituted
@@ -841,20 +974,21 @@ static void findExps(PPROC pProc)
 
                 /* PUSH doesn't define any registers, only uses registers.
                    Push the associated expression to the register on the local expression stack */
-                else if (picode->hl.opcode == PUSH) {
-                    pushExpStk(picode->hl.oper.exp);
+                else if (icodeHl(picode).opcode == PUSH) {
+                    pushExpStk(icodeHl(picode).oper.exp);
                     invalidateIcode(picode);
                     numHlIcodes--;
                 }
 
                 /* For CALL instructions that use arguments from the stack, pop them from the
                    expression stack and place them on the procedure's argument list */
-                if ((picode->hl.opcode == CALL) && !(picode->hl.oper.call.proc->flg & REG_ARGS)) {
+                if ((icodeHl(picode).opcode == CALL) &&
+                    !(icodeHl(picode).oper.call.proc->flg & REG_ARGS)) {
                     PPROC pp;
                     int cb, numArgs;
                     bool res;
 
-                    pp = picode->hl.oper.call.proc;
+                    pp = icodeHl(picode).oper.call.proc;
                     if (pp->flg & CALL_PASCAL) {
                         cb = pp->cbParam; // fixed # arguments
                         for (k = 0, numArgs = 0; k < cb; numArgs++) {
@@ -872,7 +1006,7 @@ static void findExps(PPROC pProc)
                                 k += hlTypeSize(exp, pProc);
                         }
                     } else { // CALL_C
-                        cb = picode->hl.oper.call.args->cb;
+                        cb = icodeHl(picode).oper.call.args->cb;
                         numArgs = 0;
                         if (cb)
                             for (k = 0; k < cb; numArgs++)
@@ -887,11 +1021,12 @@ static void findExps(PPROC pProc)
 
                 /* If we could not substitute the result of a function,
                    assign it to the corresponding registers */
-                if ((picode->hl.opcode == CALL) &&
-                    ((picode->hl.oper.call.proc->flg & PROC_ISLIB) != PROC_ISLIB) &&
-                    (picode->du1.idx[0][0] == 0) && (picode->du1.numRegsDef > 0)) {
-                    exp = idCondExpFunc(picode->hl.oper.call.proc, picode->hl.oper.call.args);
-                    lhs = idCondExpID(&picode->hl.oper.call.proc->retVal, &pProc->localId, j);
+                if ((icodeHl(picode).opcode == CALL) &&
+                    ((icodeHl(picode).oper.call.proc->flg & PROC_ISLIB) != PROC_ISLIB) &&
+                    (du1->idx[0][0] == 0) && (picode->numRegsDef > 0)) {
+                    exp = idCondExpFunc(icodeHl(picode).oper.call.proc,
+                                        icodeHl(picode).oper.call.args);
+                    lhs = idCondExpID(&icodeHl(picode).oper.call.proc->retVal, &pProc->localId, j);
                     newAsgnHlIcode(picode, lhs, exp);
                 }
             }
@@ -903,11 +1038,13 @@ static void findExps(PPROC pProc)
 }
 
 /*
- Invokes procedures related with data flow analysis. Works on a procedure at a time basis.
- Note: indirect recursion in liveRegAnalysis is possible.
+ Starts the data flow analysis of the procedure: sets its return value from the registers live
+ on return, eliminates condition codes, and starts its live register analysis.
 */
-void dataFlow(PPROC pProc, uint32_t liveOut)
+static void startDataFlow(PPROC pProc, uint32_t liveOut)
 {
+    setExpArena(&pProc->expArena);
+
     // Remove references to register variables
     if (pProc->flg & SI_REGVAR)
         liveOut &= maskDuReg[rSI];
@@ -949,10 +1086,240 @@ void dataFlow(PPROC pProc, uint32_t liveOut)
     pProc->liveAnal = true;
     elimCondCodes(pProc);
     genLiveKtes(pProc);
-    liveRegAnalysis(pProc, liveOut); // calls dataFlow() recursively
 
-    if (!(pProc->flg & PROC_ASM)) { // can generate C for pProc
-        genDU1(pProc);   // generate def/use level 1 chain
-        findExps(pProc); // forward substitution algorithm
+    // Live register analysis, and search for its strongly connected component
+    if (sched.numLive == sched.allocLive) {
+        sched.allocLive = sched.allocLive ? sched.allocLive * 2 : 16;
+        sched.live = allocVar(sched.live, sched.allocLive * sizeof(LIVE_FRAME));
+    }
+
+    LIVE_FRAME *f = &sched.live[sched.numLive++];
+    f->proc = pProc;
+    f->liveOut = pProc->liveOut = liveOut;
+    f->work = NULL;
+    f->queued = NULL;
+    f->resume = false;
+
+    int idx = dfNode(pProc);
+    sched.node[idx].onStack = true;
+}
+
+/*
+ Finishes the search for the strongly connected component of the procedure, whose live register
+ analysis is done. When it is the first procedure of its component found, the component is
+ complete: if it is recursive, the analysis of its procedures is repeated until their live
+ registers do not change.
+*/
+static void finishDataFlow(PPROC pProc)
+{
+    int idx = pProc->dfIdx;
+    bool recursive = false; // Procedure calls itself
+
+    for (int i = 0; i < pProc->numBBs; i++) {
+        PPROC pcallee = bbCallee(pProc, pProc->dfsLast[i]);
+
+        if (pcallee && pcallee->dfIdx && sched.node[pcallee->dfIdx].onStack &&
+            sched.node[pcallee->dfIdx].lowLink < sched.node[idx].lowLink)
+            sched.node[idx].lowLink = sched.node[pcallee->dfIdx].lowLink;
+        if (pcallee == pProc)
+            recursive = true;
+    }
+
+    sched.sccStk[sched.numSccStk++] = idx;
+    if (sched.node[idx].lowLink != idx) // Not the first procedure of its component
+        return;
+
+    // Its procedures are the ones found after this one still on the stack
+    if (sched.numScc == sched.allocScc) {
+        sched.allocScc = sched.allocScc ? sched.allocScc * 2 : 64;
+        sched.scc = allocVar(sched.scc, sched.allocScc * sizeof(DF_SCC));
+    }
+
+    DF_SCC *scc = &sched.scc[sched.numScc];
+    scc->first = sched.numSccProcs;
+    scc->numProcs = 0;
+    while ((scc->numProcs < sched.numSccStk) &&
+           (sched.sccStk[sched.numSccStk - scc->numProcs - 1] >= idx))
+        scc->numProcs++;
+
+    sched.numSccStk -= scc->numProcs;
+    for (int i = 0; i < scc->numProcs; i++) {
+        DF_NODE *n = &sched.node[sched.sccStk[sched.numSccStk + i]];
+
+        n->onStack = false;
+        n->scc = sched.numScc;
+        sched.sccProcs[sched.numSccProcs++] = n->proc;
+    }
+    sched.numScc++;
+
+    // Repeat the analysis of recursive procedures until their liveIn do not change
+    if (scc->numProcs > 1 || recursive) {
+        bool change = true;
+
+        while (change) {
+            change = false;
+            for (int i = scc->first; i < scc->first + scc->numProcs; i++) {
+                LIVE_FRAME f = { sched.sccProcs[i], sched.sccProcs[i]->liveOut };
+                uint32_t prevLiveIn = f.proc->liveIn;
+
+                setExpArena(&f.proc->expArena);
+                liveRegAnalysis(&f);
+                if (f.proc->liveIn != prevLiveIn)
+                    change = true;
+            }
+        }
     }
 }
+
+/*
+ Returns whether the analysis of the callers of the procedure must be in the order they would be
+ analysed serially: the procedure has been analysed, or takes arguments in registers, so its
+ callers' expressions update its arguments.
+*/
+static bool sharedCallee(PPROC pcallee)
+{
+    return pcallee->liveAnal || (pcallee->liveIn != 0);
+}
+
+/*
+ Sets the level of each strongly connected component. A component comes after the components
+ of its callees, and after the components completed before it that call a procedure it calls
+ too. Components of the same level can be analysed at the same time. Returns the highest level.
+*/
+static int levelScc(void)
+{
+    int maxLevel = 0;
+    int *lastCaller; // Last component calling each procedure, -1 if none
+
+    for (int i = 0; i < sched.numSccProcs; i++) {
+        PPROC pProc = sched.sccProcs[i];
+        for (int j = 0; j < pProc->numBBs; j++) {
+            PPROC pcallee = bbCallee(pProc, pProc->dfsLast[j]);
+            if (pcallee && sharedCallee(pcallee))
+                dfNode(pcallee);
+        }
+    }
+
+    lastCaller = allocMem(sched.numNodes * sizeof(int));
+    memset(lastCaller, -1, sched.numNodes * sizeof(int));
+
+    for (int s = 0; s < sched.numScc; s++) {
+        DF_SCC *scc = &sched.scc[s];
+
+        scc->level = 1;
+        for (int i = scc->first; i < scc->first + scc->numProcs; i++) {
+            PPROC pProc = sched.sccProcs[i];
+
+            for (int j = 0; j < pProc->numBBs; j++) {
+                PPROC pcallee = bbCallee(pProc, pProc->dfsLast[j]);
+                if (!pcallee || !sharedCallee(pcallee))
+                    continue;
+
+                int callee = sched.node[pcallee->dfIdx].scc;
+                if (callee != -1 && callee != s && sched.scc[callee].level >= scc->level)
+                    scc->level = sched.scc[callee].level + 1;
+
+                int caller = lastCaller[pcallee->dfIdx];
+                if (caller != -1 && caller != s && sched.scc[caller].level >= scc->level)
+                    scc->level = sched.scc[caller].level + 1;
+            }
+        }
+
+        for (int i = scc->first; i < scc->first + scc->numProcs; i++) {
+            PPROC pProc = sched.sccProcs[i];
+
+            for (int j = 0; j < pProc->numBBs; j++) {
+                PPROC pcallee = bbCallee(pProc, pProc->dfsLast[j]);
+                if (pcallee && sharedCallee(pcallee))
+                    lastCaller[pcallee->dfIdx] = s;
+            }
+        }
+
+        if (scc->level > maxLevel)
+            maxLevel = scc->level;
+    }
+
+    free(lastCaller);
+    return maxLevel;
+}
+
+// Generates the def/use chains and expressions of the procedures of the component level[i]
+static void findSccExps(int i, void *level)
+{
+    DF_SCC *scc = &sched.scc[((int *)level)[i]];
+
+    for (int j = scc->first; j < scc->first + scc->numProcs; j++) {
+        PPROC pProc = sched.sccProcs[j];
+
+        if (!(pProc->flg & PROC_ASM)) { // can generate C for pProc
+            setExpArena(&pProc->expArena);
+            genDU1(pProc);   // generate def/use level 1 chain
+            findExps(pProc); // forward substitution algorithm
+
+            if (!option.verbose) { // else the chains are listed with the code
+                free(pProc->Icode.du1);
+                pProc->Icode.du1 = NULL;
+            }
+        }
+    }
+}
+
+/*
+ Invokes procedures related with data flow analysis. The live register analysis is done from
+ the procedure pProc, which is the first one called, down to its callees in the order the calls
+ are found; recursive procedures are analysed until their live registers do not change. The
+ def/use chains and expressions are then found callees first, independent procedures in parallel.
+*/
+void dataFlow(PPROC pProc, uint32_t liveOut)
+{
+    EXP_ARENA *prevArena = setExpArena(NULL);
+
+    startDataFlow(pProc, liveOut);
+
+    while (sched.numLive > 0) {
+        LIVE_FRAME *f = &sched.live[sched.numLive - 1];
+
+        setExpArena(&f->proc->expArena);
+        PPROC pcallee = liveRegAnalysis(f);
+
+        if (pcallee) // Analyse the callee with the registers live after the call
+            startDataFlow(pcallee, f->proc->dfsLast[f->i]->liveOut);
+        else {
+            sched.numLive--;
+            finishDataFlow(f->proc);
+        }
+    }
+
+    // Components by level, each level in the order they were completed
+    int maxLevel = levelScc();
+    int *first = allocMem((maxLevel + 2) * sizeof(int)); // First component of each level
+
+    memset(first, 0, (maxLevel + 2) * sizeof(int));
+    for (int s = 0; s < sched.numScc; s++)
+        first[sched.scc[s].level + 1]++;
+    for (int l = 1; l <= maxLevel + 1; l++)
+        first[l] += first[l - 1];
+
+    sched.level = allocMem(sched.numScc * sizeof(int));
+    for (int s = 0; s < sched.numScc; s++)
+        sched.level[first[sched.scc[s].level]++] = s;
+
+    for (int l = 1, start = 0; l <= maxLevel; l++) {
+        int end = first[l];
+        parallelFor(end - start, findSccExps, &sched.level[start]);
+        start = end;
+    }
+
+    for (int i = 1; i < sched.numNodes; i++)
+        sched.node[i].proc->dfIdx = 0;
+
+    free(first);
+    free(sched.level);
+    free(sched.live);
+    free(sched.sccStk);
+    free(sched.scc);
+    free(sched.sccProcs);
+    free(sched.node);
+    memset(&sched, 0, sizeof(sched));
+    setExpArena(prevArena);
+}
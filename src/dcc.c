@@ -29,6 +29,8 @@
 #include <getopt.h>
 #include <stdbool.h>
 
+#define MAX_JOBS 256 // Larger -j counts are cut down to this many threads
+
 // Global variables - extern to other modules
 char *progname;              // argv[0] - for error msgs
 char *asm1_name, *asm2_name; // Assembler output filenames
@@ -51,6 +53,8 @@ static struct option opt[] = {
     {"asm1",         no_argument,       0, 'a'},
     {"asm2",         no_argument,       0, 'A'},
     {"file",         required_argument, 0, 'f'},
+    {"jobs",         required_argument, 0, 'j'},
+    {"predecode",    no_argument,       0, 'p'},
     {0, 0, 0, 0}
 };
 
@@ -94,11 +98,25 @@ static void help() {
         "\n    -a, --asm1           Assembler output before re-ordering of input code"
         "\n    -A, --asm2           Assembler output after re-ordering of input code"
         "\n    -f, --file           Filename of the executable"
+        "\n    -j, --jobs N         Decompile procedures with N threads"
+        "\n    -p, --predecode      Decode the whole image in parallel before parsing"
         "\n\n"
     );
     exit(EXIT_FAILURE);
 }
 
+// parseJobs - Returns the thread count given to -j; it must be a whole number of at least 1
+static int parseJobs(const char *str)
+{
+    char *end;
+    long n = strtol(str, &end, 10);
+
+    if (end == str || *end != '\0' || n < 1)
+        fatalError(USAGE);
+
+    return (n > MAX_JOBS) ? MAX_JOBS : (int)n;
+}
+
 // initargs - Extract command line arguments
 static char *initargs(int argc, char *argv[])
 {
@@ -110,7 +128,7 @@ static char *initargs(int argc, char *argv[])
     int c, opt_idx = 0;
     char *filename;
 
-    while ((c = getopt_long(argc, argv, "hvVsmiaAf:", opt, &opt_idx)) != -1) {
+    while ((c = getopt_long(argc, argv, "hvVsmiaAf:j:p", opt, &opt_idx)) != -1) {
         switch (c) {
         case 'h':
             help();
@@ -139,6 +157,12 @@ static char *initargs(int argc, char *argv[])
         case 'f':
             filename = optarg;
             break;
+        case 'j':
+            option.numJobs = parseJobs(optarg);
+            break;
+        case 'p':
+            option.predecode = true;
+            break;
         default:
             fatalError(USAGE);
         }
@@ -172,6 +196,7 @@ int main(int argc, char *argv[])
     BackEnd(filename, callGraph);
 
     writeCallGraph(callGraph);
+    stopJobs();
 
     // freeDataStructures(pProcList);
 
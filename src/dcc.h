@@ -50,12 +50,18 @@
 // Returns a signed quantity, e.g. C000 is read into an Int as FFFFC000
 #define LHS(p) (((uint8_t *)(p))[0] + (((char *)(p))[1] << 8))
 
-// Macro tests bit b for type t in prog.map
-#define BITMAP(b, t) (prog.map[(b) >> 2] & ((t) << (((b)&3) << 1)))
+// Macro returns the memory map type (BM_xxx) of image byte b
+#define MAPTYPE(b) ((prog.map[(b) >> 5] >> (((b)&31) << 1)) & 3)
+
+// Macro tests whether a relocated word starts at image offset b (b < prog.cbImage)
+#define RELOCMAP(b) (prog.relocMap[(b) >> 3] & (1 << ((b)&7)))
 
 // Macro to convert a segment, offset definition into a 20 bit address
 #define opAdr(seg, off) ((seg << 4) + off)
 
+// Macro hashes a label or address into a slot of a table of size mask + 1 (a power of 2)
+#define HASH(key, mask) (((uint32_t)(key) * 2654435761u) & (mask))
+
 #include "ast.h"
 #include "bundle.h"
 #include "error.h"
@@ -87,9 +93,11 @@ typedef struct {
 typedef SYM *PSYM;
 
 typedef struct {
-    int csym;  // No. of symbols in table
-    int alloc; // Allocation
-    PSYM sym;  // Symbols
+    int csym;     // No. of symbols in table
+    int alloc;    // Allocation
+    PSYM sym;     // Symbols
+    int idxAlloc; // # slots in the label index (power of 2)
+    int *idx;     // Hashed label => symbol index, -1 if empty slot
 } SYMTAB;
 typedef SYMTAB *PSYMTAB;
 
@@ -121,6 +129,28 @@ typedef struct _STKFRAME {
 typedef STKFRAME *PSTKFRAME;
 
 // PROCEDURE NODE
+// Graph statistics of a procedure
+typedef struct {
+    int numBBbef;      // # BBs before deleting redundant ones
+    int numBBaft;      // # BBs after deleting redundant ones
+    int numEdgesBef;   // # out edges before removing redundancy
+    int numEdgesAft;   // # out edges after removing redundancy
+    int nOrder;        // nth order graph, value for n
+    int numLivePasses; // # live register analyses, several for recursive procedures
+    int numLiveVisits; // # BBs processed by the live register analyses
+    double bbTime;     // Time to build the BBs, in ms
+    double edgeTime;   // Time to link the BBs' out edges, in ms
+} CFG_STATS;
+
+/* Calling convention of a procedure found by the idiom analysis of a procedure. The analysis
+   of procedures may run concurrently, so these are only recorded, and applied in procedure
+   order by setCallConv(). */
+typedef struct {
+    struct _proc *proc; // Procedure the convention is for
+    int16_t cb;         // # bytes of parameters
+    uint32_t flg;       // CALL_C or CALL_PASCAL; CALL_UNKNOWN if cb only replaces a different #
+} CALL_CONV;
+
 typedef struct _proc {
     uint32_t procEntry; // label number
     char name[SYMLEN];  // Meaningful name for this proc
@@ -135,14 +165,25 @@ typedef struct _proc {
     // Icodes and control flow graph
     ICODE_REC Icode; // Record of ICODE records
     PBB cfg;         // Ptr. to BB list/CFG
+    BB_POOL bbPool;  // BBs and edges of cfg and of its derived graphs
     PBB *dfsLast;    // Array of pointers to BBs in dfsLast (reverse postorder) order
     int numBBs;      // Number of BBs in the graph cfg
     bool hasCase;    // Procedure has a case node
+    CFG_STATS stats; // Statistics on the graph
+
+    // Calling conventions found by the idiom analysis, see CALL_CONV
+    CALL_CONV *callConv; // Conventions in the order found
+    int numCallConv;     // # conventions in callConv
+    int allocCallConv;   // # conventions allocated in callConv
 
     // For interprocedural live analysis
     uint32_t liveIn;  // Registers used before defined
     uint32_t liveOut; // Registers that may be used in successors
     bool liveAnal;    // Procedure has been analysed already
+    int dfIdx;        // Index in the data flow schedule, 0 if none (see dataflow.c)
+
+    struct _callGraph *callNode; // Node of this proc in the call graph
+    EXP_ARENA expArena;          // Expression nodes of this proc's icodes and arguments
 
     // Double-linked list
     struct _proc *next;
@@ -150,21 +191,24 @@ typedef struct _proc {
 } PROC;
 typedef PROC *PPROC;
 
-// CALL GRAPH NODE
+/* CALL GRAPH NODE
+   There is one node per procedure. A node is a child of the node of its first caller in the
+   call graph tree; the other arcs into it are cross arcs. */
 typedef struct _callGraph {
     PPROC proc;                   // Pointer to procedure in pProcList
+    struct _callGraph *parent;    // Node of the first caller, NULL for the root
     int numOutEdges;              // # of out edges (ie. # procs invoked)
     int numAlloc;                 // # of out edges allocated
     struct _callGraph **outEdges; // array of out edges
 } CALL_GRAPH;
 typedef CALL_GRAPH *PCALL_GRAPH;
 
-#define NUM_PROCS_DELTA 5 // delta # procs a proc invokes
+#define NUM_PROCS_INIT 4 // initial # procs a proc invokes, doubled as needed
 
 extern PPROC pProcList;       // Pointer to the head of the procedure list
 extern PPROC pLastProc;       // Pointer to last node of the proc list
 extern PCALL_GRAPH callGraph; // Pointer to the head of the call graph
-extern bundle cCode;          // Output C procedure's declaration and code
+extern _Thread_local bundle cCode; // Output C procedure's declaration and code
 
 // Procedure FLAGS
 #define PROC_BADINST 0x000100   // Proc contains invalid or 386 instruction
@@ -198,11 +242,13 @@ extern char *asm1_name, *asm2_name; // Assembler output filenames
 typedef struct {
     bool verbose;
     bool VeryVerbose;
-    bool asm1;     // Early disassembly listing
-    bool asm2;     // Disassembly listing after restruct
+    bool asm1;      // Early disassembly listing
+    bool asm2;      // Disassembly listing after restruct
     bool Map;
     bool Stats;
-    bool Interact; // Interactive mode
+    bool Interact;  // Interactive mode
+    int numJobs;    // # threads generating code
+    bool predecode; // Predecode the image before parsing
 } OPTION;
 
 extern OPTION option; // Command line options
@@ -217,11 +263,12 @@ typedef struct {
 //    bool fCOM;          // Flag set if COM program (else EXE)
     uint16_t cReloc;      // No. of relocation table entries
     uint32_t *relocTable; // Ptr. to relocation table
+    uint8_t  *relocMap;   // Relocation bitmap, 1 bit per image byte
     uint32_t cProcs;      // Number of procedures so far
     uint32_t offMain;     // The offset  of the main() proc
     uint16_t segMain;     // The segment of the main() proc
     size_t   cbImage;     // Length of image in bytes
-    uint8_t  *map;        // Memory bitmap ptr
+    uint64_t *map;        // Memory bitmap ptr, see memmap.c
     uint8_t  *Image;      // Allocated by loader to hold entire program image
 } PROG;
 
@@ -242,16 +289,32 @@ static char *allRegs[21] = { "ax", "cx", "dx", "bx", "sp", "bp", "si", "di", "es
 #define BM_CODE    2 // Code
 #define BM_IMPURE  3 // Used as Data and Code
 
-// Graph statistics
+// Front end statistics, for the whole program
 typedef struct {
-    int numBBbef;    // # BBs before deleting redundant ones
-    int numBBaft;    // # BBs after deleting redundant ones
-    int numEdgesBef; // # out edges before removing redundancy
-    int numEdgesAft; // # out edges after removing redundancy
-    int nOrder;      // nth order graph, value for n
+    int numRelocLookups; // # relocation table lookups by the scanner
+    int numRelocHits;    // # lookups that found a relocated word
+    int numIcodeReallocs;    // # times an icode array was grown
+    long numIcodeBytesMoved; // # bytes of icode held by the arrays when grown
+    int numPredecoded;       // # instructions in the predecode cache
+    int numPredecodeHits;    // # scans answered from the predecode cache
 } STATS;
 
-extern STATS stats; // cfg statistics
+extern STATS stats; // Front end statistics
+
+// Instruction decoder, see decode() in scanner.c. Each thread decoding needs its own.
+typedef struct {
+    uint8_t *image;      // Image the instructions are decoded from
+    uint32_t cbImage;    // Length of image in bytes
+    uint8_t *relocMap;   // Relocation bitmap of image, 1 bit per byte; NULL if none
+    int numRelocLookups; // # relocation bitmap lookups
+    int numRelocHits;    // # lookups that found a relocated word
+
+    // Instruction being decoded
+    uint8_t *pInst;      // Ptr. to current byte of instruction
+    PICODE pIcode;       // Ptr to Icode record being filled in
+    uint16_t segPrefix;  // Segment override prefix not used yet
+    uint16_t repPrefix;  // REP prefix not used yet
+} DECODER;
 
 
 // Global function prototypes
@@ -261,38 +324,59 @@ void *allocVar(void *p, int newsize);                      // frontend.c
 void udm(void);                                            // udm.c
 PBB createCFG(PPROC pProc);                                // graph.c
 void compressCFG(PPROC pProc);                             // graph.c
-void freeCFG(PBB cfg);                                     // graph.c
+void freeBBPool(BB_POOL *pool);                            // graph.c
 PBB newBB(PBB, int, int, uint8_t, int, PPROC);             // graph.c
 void BackEnd(char *filename, PCALL_GRAPH);                 // backend.c
 char *cChar(char c);                                       // backend.c
+void freeLineBuf(void);                                    // backend.c
+void initDecoder(DECODER *d, uint8_t *image, uint32_t cbImage, uint8_t *relocMap); // scanner.c
+int decode(DECODER *d, uint32_t ip, PICODE p);             // scanner.c
 int scan(uint32_t ip, PICODE p);                           // scanner.c
+void predecode(void);                                       // scanner.c
+void invalidatePredecode(uint32_t start, uint32_t len);     // scanner.c
+void freePredecode(void);                                   // scanner.c
 void parse(PCALL_GRAPH *);                                 // parser.c
-bool labelSrch(PICODE pIc, int n, uint32_t tg, int *pIdx); // parser.c
 void setState(PSTATE state, uint16_t reg, int16_t value);  // parser.c
 size_t strSize(uint8_t *, char);                           // parser.c
+int findGlobSym(uint32_t label);                           // parser.c
 void disassem(int pass, PPROC pProc);                      // disassem.c
 void interactDis(PPROC initProc, int initIC);              // disassem.c
 void bindIcodeOff(PPROC);                                  // idioms.c
 void lowLevelAnalysis(PPROC pProc);                        // idioms.c
+void setCallConv(PPROC pProc);                             // idioms.c
 void propLong(PPROC pproc);                                // proplong.c
 bool JmpInst(llIcode opcode);                              // idioms.c
 void checkReducibility(PPROC pProc, derSeq **derG);        // reducible.c
-queue *appendQueue(queue **Q, BB *node);                   // reducible.c
 void freeDerivedSeq(derSeq *derivedG);                     // reducible.c
-void displayDerivedSeq(derSeq *derG);                      // reducible.c
+void freeIntPool(void);                                    // reducible.c
+void displayDerivedSeq(strBuf *sb, derSeq *derG);          // reducible.c
+void findDominators(PPROC pProc);                          // domtree.c
 void structure(PPROC pProc, derSeq *derG);                 // control.c
 void compoundCond(PPROC);                                  // control.c
 void dataFlow(PPROC pProc, uint32_t liveOut);              // dataflow.c
 void writeIntComment(PICODE icode, char *s);               // comwrite.c
 void writeProcComments(PPROC pProc, strTable *sTab);       // comwrite.c
+size_t mapSize(size_t cb);                                 // memmap.c
+void setBits(int16_t type, uint32_t start, uint32_t len);  // memmap.c
+bool testBits(int16_t type, uint32_t start, uint32_t len); // memmap.c
+uint32_t nextBits(int16_t type, uint32_t start, uint32_t end); // memmap.c
+uint32_t nextChange(uint32_t start);                       // memmap.c
+void indexCode(void);                                      // memmap.c
+bool codeBits(uint32_t start, uint32_t len);               // memmap.c
+void parallelFor(int numTasks, void (*task)(int, void *), void *arg); // jobs.c
+void stopJobs(void);                                       // jobs.c
 void checkStartup(PSTATE pState);                          // chklib.c
 bool SetupLibCheck(void);                                  // chklib.c
 void CleanupLibCheck(void);                                // chklib.c
 bool LibCheck(PPROC p);                                    // chklib.c
 
 // Exported functions from procs.c
-bool insertCallGraph(PCALL_GRAPH, PPROC, PPROC);
+PPROC newProc(uint32_t procEntry);
+PPROC findProc(uint32_t procEntry);
+PCALL_GRAPH newCallGraph(PPROC, PCALL_GRAPH);
+void insertCallGraph(PPROC, PPROC);
 void writeCallGraph(PCALL_GRAPH);
+void growStkFrame(PSTKFRAME, int alloc);
 void newRegArg(PPROC, PICODE, PICODE);
 bool newStkArg(PICODE, COND_EXPR *, llIcode, PPROC);
 void allocStkArgs(PICODE, int);
@@ -317,7 +401,7 @@ COND_EXPR *idCondExpID(ID *, LOCAL_ID *, int);
 COND_EXPR *idCondExp(PICODE, opLoc, PPROC, int i, PICODE duIcode, operDu);
 COND_EXPR *copyCondExp(COND_EXPR *);
 void removeRegFromLong(uint8_t, LOCAL_ID *, COND_EXPR *);
-char *walkCondExpr(COND_EXPR *exp, PPROC pProc, int *);
+void walkCondExpr(strBuf *, COND_EXPR *exp, PPROC pProc, int *);
 condId idType(PICODE pIcode, opLoc sd);
 int hlTypeSize(COND_EXPR *, PPROC);
 hlType expType(COND_EXPR *, PPROC);
@@ -326,9 +410,12 @@ void copyDU(PICODE, PICODE, operDu, operDu);
 void changeBoolCondExpOp(COND_EXPR *, condOp);
 bool insertSubTreeReg(COND_EXPR *, COND_EXPR **, uint8_t, LOCAL_ID *);
 bool insertSubTreeLongReg(COND_EXPR *, COND_EXPR **, int);
-void freeCondExpr(COND_EXPR *exp);
+EXP_ARENA *setExpArena(EXP_ARENA *);
+void freeExpArena(EXP_ARENA *);
+struct _hl *allocHlPart(void);
 COND_EXPR *concatExps(SEQ_COND_EXPR *, COND_EXPR *, condNodeType);
 void initExpStk();
+void freeExpStk();
 void pushExpStk(COND_EXPR *);
 COND_EXPR *popExpStk();
 int numElemExpStk();
@@ -336,19 +423,23 @@ bool emptyExpStk();
 
 // Exported functions from hlicode.c
 PICODE newIcode(ICODE_REC *, PICODE);
+void reserveIcode(ICODE_REC *, int n);
+void packIcode(ICODE_REC *);
+int newCaseTbl(ICODE_REC *, int numEntries);
+bool labelSrch(ICODE_REC *, uint32_t target, int *pIndex);
 void newAsgnHlIcode(PICODE, COND_EXPR *, COND_EXPR *);
 void newCallHlIcode(PICODE);
 void newUnaryHlIcode(PICODE, hlIcode, COND_EXPR *);
 void newJCondHlIcode(PICODE, COND_EXPR *);
 void invalidateIcode(PICODE);
-bool removeDefRegi(uint8_t, PICODE, int, LOCAL_ID *);
+bool removeDefRegi(uint8_t, ICODE_REC *, PICODE, int, LOCAL_ID *);
 void highLevelGen(PPROC);
-char *writeCall(PPROC, PSTKFRAME, PPROC, int *);
-char *write1HlIcode(struct _hl, PPROC, int *);
-char *writeJcond(struct _hl, PPROC, int *);
-char *writeJcondInv(struct _hl, PPROC, int *);
+void writeCall(strBuf *, PPROC, PSTKFRAME, PPROC, int *);
+void write1HlIcode(strBuf *, struct _hl, PPROC, int *);
+void writeJcond(strBuf *, struct _hl, PPROC, int *);
+void writeJcondInv(strBuf *, struct _hl, PPROC, int *);
 int power2(int);
-void writeDU(PICODE, int);
+void writeDU(ICODE_REC *, int);
 void inverseCondOp(COND_EXPR **);
 
 // Exported funcions from locident.c
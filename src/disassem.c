@@ -124,6 +124,7 @@ static char *strDst(uint32_t flg, PMEM pm);
 static char *strSrc(PICODE pc);
 static char *strHex(uint32_t d);
 static int checkScanned(uint32_t pcCur);
+static bool icodeSrch(uint32_t target, int *pIndex);
 static void setProc(PPROC proc);
 static void dispData(uint16_t dataSeg);
 static void flops(PICODE pi);
@@ -187,7 +188,7 @@ void disassem(int pass, PPROC ppProc)
             if ((pc[i].ll.flg & I) && !(pc[i].ll.flg & JMP_ICODE) &&
                 JmpInst(pc[i].ll.opcode)) {
                 // Replace the immediate operand with an icode index
-                if (labelSrch(pc, numIcode, pc[i].ll.immed.op, (int *)&pc[i].ll.immed.op)) {
+                if (labelSrch(&pProc->Icode, pc[i].ll.immed.op, (int *)&pc[i].ll.immed.op)) {
                     // This icode is the target of a jump
                     pc[pc[i].ll.immed.op].ll.flg |= TARGET;
                     pc[i].ll.flg |= JMP_ICODE; // So its not done twice
@@ -421,7 +422,7 @@ static void dis1Line(int i, bool fWindow, chtype attr, int pass)
     case iCALLF:
         if (pIcode->ll.flg & I) {
             sprintf(p, "%s ptr %s", (pIcode->ll.opcode == iCALL) ? " near" : "  far",
-                    (pIcode->ll.immed.proc.proc)->name);
+                    (pIcode->ll.immed.proc)->name);
         } else if (pIcode->ll.opcode == iCALLF) {
             strcat(strcpy(p, "dword ptr"), strSrc(pIcode) + 1);
         } else {
@@ -502,9 +503,8 @@ static void dis1Line(int i, bool fWindow, chtype attr, int pass)
     if (pIcode->ll.flg & SYNTHETIC) {
         fImpure = FALSE;
     } else {
-        for (j = pIcode->ll.label, fImpure = 0; j > 0 && j < (int)nextInst; j++) {
-            fImpure |= BITMAP(j, BM_DATA);
-        }
+        fImpure = pIcode->ll.label > 0 && pIcode->ll.label < nextInst &&
+                  testBits(BM_DATA, pIcode->ll.label, nextInst - pIcode->ll.label);
     }
 
     // Check for user supplied comment
@@ -520,7 +520,7 @@ static void dis1Line(int i, bool fWindow, chtype attr, int pass)
         buf[strlen(buf)] = ' ';
         buf[POS_CMT] = '\0';
         if (pIcode->ll.flg & CASE) {
-            sprintf(buf + POS_CMT, ";Case l%d", pIcode->ll.caseTbl.numEntries);
+            sprintf(buf + POS_CMT, ";Case l%d", pIcode->ll.caseIdx);
         }
         if (pIcode->ll.flg & SWITCH) {
             strcat(buf, ";Switch ");
@@ -694,7 +694,7 @@ void updateScr(bool new)
     nextInst = pcTop;
     for (y = 1, ic = icTop; y < LINES - 1; ic++) {
         if ((ic >= numIcode) || (nextInst != pc[ic].ll.label)) {
-            if (labelSrch(pc, numIcode, nextInst, &i)) {
+            if (icodeSrch(nextInst, &i)) {
                 ic = i;
             } else {
                 pcLast = pc[ic - 1].ll.label; // Remember end of proc
@@ -792,6 +792,22 @@ void popPosStack(void)
 }
 
 
+/*
+   Searches the temporary code array for the icode with label = target. The array may have
+   grown past the procedure's icodes (see checkScanned()), so the label index is not used.
+*/
+static bool icodeSrch(uint32_t target, int *pIndex)
+{
+    for (int i = 0; i < numIcode; i++) {
+        if (pc[i].ll.label == target) {
+            *pIndex = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+
 /*
    Check to see if there is an icode for given image offset.
    Scan it if necessary, adjusting the allocation of pc[] and pl[] if necessary.
@@ -806,7 +822,7 @@ static int checkScanned(uint32_t pcCur)
     if (pcCur >= (uint32_t)prog.cbImage) // Couldn't be!
         return -1;
 
-    if (!labelSrch(pc, numIcode, pcCur, &i)) {
+    if (!icodeSrch(pcCur, &i)) {
         // This icode does not exist yet. Tack it on the end of the existing
         if (numIcode >= allocIcode) {
             allocIcode = numIcode + DELTA_ICODE; // Make space for this one, and a few more
@@ -857,7 +873,7 @@ static void setProc(PPROC proc)
         if ((pc[i].ll.flg & I) && !(pc[i].ll.flg & JMP_ICODE) &&
             JmpInst(pc[i].ll.opcode)) {
             // Immediate jump instructions. Make dest an icode index
-            if (labelSrch(pc, numIcode, pc[i].ll.immed.op, (int *)&pc[i].ll.immed.op)) {
+            if (labelSrch(&pProc->Icode, pc[i].ll.immed.op, (int *)&pc[i].ll.immed.op)) {
                 // This icode is the target of a jump
                 pc[pc[i].ll.immed.op].ll.flg |= TARGET;
                 pc[i].ll.flg |= JMP_ICODE; // So its not done twice
@@ -870,7 +886,7 @@ static void setProc(PPROC proc)
 
     // Window initially scrolled with entry point on top
     pcCur = pcTop = pProc->procEntry;
-    labelSrch(pc, numIcode, pcCur, &icCur);
+    icodeSrch(pcCur, &icCur);
     // pcLast is set properly in updateScr(), at least for now
     pcLast = -1;
 }
@@ -917,7 +933,7 @@ void interactDis(PPROC initProc, int initIC)
             if (pcCur >= pcLast)
                 continue; // Ignore it
             pcCur += pc[icCur].ll.numBytes;
-            labelSrch(pc, numIcode, pcCur, &icCur);
+            icodeSrch(pcCur, &icCur);
             if (pcCur >= pcBot) {
                 // We have gone past the bottom line. Scroll a few lines
                 for (int j = 0; j < NSCROLL; j++) {
@@ -926,7 +942,7 @@ void interactDis(PPROC initProc, int initIC)
 
                     pcTop += pc[icTop].ll.numBytes;
 
-                    if (labelSrch(pc, numIcode, pcTop, &i))
+                    if (icodeSrch(pcTop, &i))
                         icTop = i;
                     else
                         break; // Some problem... no more scroll
@@ -960,7 +976,7 @@ void interactDis(PPROC initProc, int initIC)
             if (pc[icCur].ll.src.off != 0) {
                 pushPosStack();
                 pcCur = pc[icCur].ll.src.off;
-                if (!labelSrch(pc, numIcode, pcCur, &icCur))
+                if (!icodeSrch(pcCur, &icCur))
                     break;
                 updateScr(false);
             }
@@ -997,14 +1013,14 @@ void interactDis(PPROC initProc, int initIC)
             } else if (pc[icCur].ll.dst.off != 0) {
                 pushPosStack();
                 pcCur = pc[icCur].ll.dst.off;
-                if (!labelSrch(pc, numIcode, pcCur, &icCur)) {
+                if (!icodeSrch(pcCur, &icCur)) {
                     dispData(pProc->state.r[rDS]);
                     break;
                 }
             } else if (pc[icCur].ll.src.off != 0) {
                 pushPosStack();
                 pcCur = pc[icCur].ll.src.off;
-                if (!labelSrch(pc, numIcode, pcCur, &icCur)) {
+                if (!icodeSrch(pcCur, &icCur)) {
                     dispData(pProc->state.r[rDS]);
                     break;
                 }
@@ -1186,22 +1202,18 @@ static void dispData(uint16_t dataSeg)
 
 bool callArg(uint16_t off, char *sym)
 {
-    PPROC p, pPrev;
+    PPROC p;
 
     uint32_t imageOff = off + ((uint32_t)pProc->state.r[rCS] << 4);
 
-    // Search procedure list for one with appropriate entry point
-    for (p = pProcList; p && p->procEntry != imageOff; p = p->next) {
-        pPrev = p;
-    }
+    // Search procedure index for one with appropriate entry point
+    p = findProc(imageOff);
 
     if (p == 0) { // No existing proc entry
         LibCheck(p);
         if (p->flg & PROC_ISLIB) {
             // No entry for this proc, but it is a library function. Create an entry for it
-            p = memset(allocStruc(PROC), 0, sizeof(PROC));
-            pPrev->next = p;
-            p->procEntry = imageOff;
+            p = newProc(imageOff);
         }
     }
 
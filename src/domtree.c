@@ -0,0 +1,128 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+// Description: Finds the dominator tree of the CFG, numbered for O(1) dominance queries
+
+#include "dcc.h"
+
+
+/*
+ Returns the nearest common dominator of the nodes a and b (dfsLast indexes). Dominators come
+ before the nodes they dominate in the dfsLast order, so the node with the greatest index is
+ replaced by its immediate dominator until both meet.
+*/
+static int commonDom(int a, int b, PPROC pProc)
+{
+    while (a != b) {
+        while (a > b)
+            a = pProc->dfsLast[a]->immedDom;
+        while (b > a)
+            b = pProc->dfsLast[b]->immedDom;
+    }
+
+    return a;
+}
+
+/*
+ Links the children of each node in the dominator tree, in dfsLast order, and numbers the nodes
+ in preorder and postorder: a dominates b if and only if a comes before b in preorder and after
+ b in postorder. The tree is walked through the immedDom and domSibling links, without a stack.
+*/
+static void numberDomTree(PPROC pProc)
+{
+    PBB pbb;
+    int v,       // dfsLast index of the current node
+        num = 0; // Next pre/postorder number
+
+    for (v = 0; v < pProc->numBBs; v++) {
+        pbb = pProc->dfsLast[v];
+        pbb->domChild = pbb->domSibling = NO_DOM;
+        pbb->domPre = pbb->domPost = -1; // Not in the tree
+    }
+
+    for (v = pProc->numBBs - 1; v > 0; v--) {
+        pbb = pProc->dfsLast[v];
+        if (pbb->immedDom != NO_DOM) {
+            pbb->domSibling = pProc->dfsLast[pbb->immedDom]->domChild;
+            pProc->dfsLast[pbb->immedDom]->domChild = v;
+        }
+    }
+
+    v = 0; // root
+    pProc->dfsLast[v]->domPre = num++;
+    while (1) {
+        pbb = pProc->dfsLast[v];
+        if (pbb->domChild != NO_DOM) { // Go down to the first child
+            v = pbb->domChild;
+            pProc->dfsLast[v]->domPre = num++;
+            continue;
+        }
+
+        // Go up to the first ancestor with a sibling not numbered yet
+        while ((v != 0) && (pProc->dfsLast[v]->domSibling == NO_DOM)) {
+            pProc->dfsLast[v]->domPost = num++;
+            v = pProc->dfsLast[v]->immedDom;
+        }
+        pProc->dfsLast[v]->domPost = num++;
+
+        if (v == 0)
+            break;
+        v = pProc->dfsLast[v]->domSibling;
+        pProc->dfsLast[v]->domPre = num++;
+    }
+}
+
+/*
+ Finds the immediate dominator of each node in the graph pProc->cfg, and numbers the dominator
+ tree (see numberDomTree). Iterative algorithm by Cooper, Harvey and Kennedy: the nodes are
+ processed in dfsLast order (reverse postorder) until no immediate dominator changes; for a
+ reducible graph one pass is enough, the second one checks that.
+*/
+void findDominators(PPROC pProc)
+{
+    bool change = true;
+
+    while (change) {
+        change = false;
+        for (int i = 1; i < pProc->numBBs; i++) {
+            PBB pbb = pProc->dfsLast[i];
+            int dom = NO_DOM;
+
+            if (pbb->flg & INVALID_BB) // Do not process invalid BBs
+                continue;
+
+            for (int j = 0; j < pbb->numInEdges; j++) {
+                PBB pred = pbb->inEdges[j];
+                int predIdx = pred->dfsLastNum;
+
+                // Skip predecessors not processed yet (the root is never processed)
+                if ((pred->flg & INVALID_BB) || ((predIdx != 0) && (pred->immedDom == NO_DOM)))
+                    continue;
+
+                dom = (dom == NO_DOM) ? predIdx : commonDom(dom, predIdx, pProc);
+            }
+
+            if (dom != pbb->immedDom) {
+                pbb->immedDom = dom;
+                change = true;
+            }
+        }
+    }
+
+    numberDomTree(pProc);
+}
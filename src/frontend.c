@@ -79,6 +79,7 @@ static MZ_Header *read_mz_header(FILE *fp);
 static void LoadImage(FILE *fp, MZ_Header *hdr);
 static void displayLoadInfo(MZ_Header *hdr);
 static void displayMemMap(void);
+static void displayStats(void);
 
 /*
  FrontEnd - invokes the loader, parser, disassembler (if asm1), icode rewritter,
@@ -88,7 +89,7 @@ void FrontEnd(char *filename, PCALL_GRAPH *pcallGraph)
 {
     PPROC pProc;
     PSYM psym;
-    int i, c;
+    int i;
 
     FILE *fp = fopen(filename, "rb");
 
@@ -119,16 +120,14 @@ void FrontEnd(char *filename, PCALL_GRAPH *pcallGraph)
     }
 
     // Search through code looking for impure references and flag them
+    indexCode();
     for (pProc = pProcList; pProc; pProc = pProc->next) {
         for (i = 0; i < pProc->Icode.numIcode; i++) {
             if (pProc->Icode.icode[i].ll.flg & (SYM_USE | SYM_DEF)) {
-                psym = &symtab.sym[pProc->Icode.icode[i].ll.caseTbl.numEntries];
-                for (c = psym->label; c < psym->label + psym->size; c++) {
-                    if (BITMAP(c, BM_CODE)) {
-                        pProc->Icode.icode[i].ll.flg |= IMPURE;
-                        pProc->flg |= IMPURE;
-                        break;
-                    }
+                psym = &symtab.sym[pProc->Icode.icode[i].ll.caseIdx];
+                if (codeBits(psym->label, psym->size)) {
+                    pProc->Icode.icode[i].ll.flg |= IMPURE;
+                    pProc->flg |= IMPURE;
                 }
             }
         }
@@ -148,6 +147,9 @@ void FrontEnd(char *filename, PCALL_GRAPH *pcallGraph)
     // Print memory bitmap
     if (option.Map)
         displayMemMap();
+
+    if (option.Stats)
+        displayStats();
 }
 
 // displayLoadInfo - Displays low level loader type info.
@@ -183,7 +185,7 @@ static void fill(int ip, char *bf)
 
     for (uint8_t i = 0; i < 16; i++, ip++) {
         *bf++ = ' ';
-        *bf++ = (ip < prog.cbImage) ? type[(prog.map[ip >> 2] >> ((ip & 3) * 2)) & 3] : ' ';
+        *bf++ = (ip < prog.cbImage) ? type[MAPTYPE(ip)] : ' ';
     }
     *bf = '\0';
 }
@@ -206,16 +208,32 @@ static void displayMemMap(void)
             fill(ip + 16, b3);
             if (!(strcmp(b1, b2) || strcmp(b1, b3))) {
                 printf("                   :\n");
-                do {
-                    ip += 16;
-                    fill(ip + 16, b1);
-                } while (!strcmp(b1, b2));
+                /* Skip to the line before the first one that is not the same, i.e. that
+                   holds a byte of another type or goes past the image */
+                int d = nextChange(ip) - ip - 32;
+                ip += (d < 0) ? 16 : (d / 16 + 1) * 16;
             }
         }
     }
     printf("\n");
 }
 
+// displayStats - Displays statistics gathered while loading and parsing the program
+static void displayStats(void)
+{
+    printf("\nStatistics - Front end\n");
+    printf("Relocation lookups:\n");
+    printf("   Total : %4d\n   Hits  : %4d\n", stats.numRelocLookups, stats.numRelocHits);
+    printf("Icode array growth:\n");
+    printf("   Reallocs    : %4d\n   Bytes moved : %ld\n\n", stats.numIcodeReallocs,
+           stats.numIcodeBytesMoved);
+    if (option.predecode) {
+        printf("Predecode cache:\n");
+        printf("   Entries : %4d\n   Hits    : %4d\n\n", stats.numPredecoded,
+               stats.numPredecodeHits);
+    }
+}
+
 static MZ_Header *read_mz_header(FILE *fp)
 {
     MZ_Header *hdr = malloc(sizeof(MZ_Header));
@@ -285,9 +303,17 @@ static void LoadImage(FILE *fp, MZ_Header *hdr)
     fread(prog.Image + sizeof(PSP), 1, cb, fp);
 
     // Set up memory map
-    cb = (prog.cbImage + 3) / 4;
+    cb = mapSize(prog.cbImage);
     prog.map = memset(allocMem(cb), BM_UNKNOWN, cb);
 
+    // Set up relocation bitmap, so that the scanner need not search the relocation table
+    cb = (prog.cbImage + 7) / 8;
+    prog.relocMap = memset(allocMem(cb), 0, cb);
+
+    for (int i = 0; i < prog.cReloc; i++)
+        if (prog.relocTable[i] < prog.cbImage)
+            prog.relocMap[prog.relocTable[i] >> 3] |= 1 << (prog.relocTable[i] & 7);
+
     // Relocate segment constants
     if (prog.cReloc) {
         for (int i = 0; i < prog.cReloc; i++) {
@@ -22,11 +22,75 @@
 #include "dcc.h"
 #include <malloc.h>
 #include <string.h>
+#include <time.h>
 
 static PBB rmJMP(PPROC pProc, int marker, PBB pBB);
 static void mergeFallThrough(PPROC pProc, PBB pBB);
 static void dfsNumbering(PBB pBB, PBB *dfsLast, int *first, int *last);
 
+#define BB_BLOCK_SIZE 16384 // # bytes of a block of a BB pool, unless more are needed at once
+
+// Block of a BB pool
+struct _bbBlock {
+    struct _bbBlock *next; // Next block, less recent
+    int size;              // # bytes of data
+    int used;              // # bytes of data allocated
+    void *data[];          // Data, aligned for pointers
+};
+
+/*
+ Returns cb bytes from the blocks of a BB pool, either pool->nodes or pool->edges. A request
+ larger than a block gets a block of its own, placed behind the one being filled.
+*/
+static void *poolAlloc(BB_BLOCK **blocks, int cb)
+{
+    BB_BLOCK *b = *blocks;
+
+    cb = (cb + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+    if (!b || (b->used + cb > b->size)) {
+        int size = (cb > BB_BLOCK_SIZE) ? cb : BB_BLOCK_SIZE;
+
+        b = allocMem(sizeof(BB_BLOCK) + size);
+        b->size = size;
+        b->used = 0;
+        if (*blocks && (size > BB_BLOCK_SIZE)) {
+            b->next = (*blocks)->next;
+            (*blocks)->next = b;
+        } else {
+            b->next = *blocks;
+            *blocks = b;
+        }
+    }
+
+    b->used += cb;
+    return (char *)b->data + b->used - cb;
+}
+
+// Releases all the BBs and edges allocated from the pool
+void freeBBPool(BB_POOL *pool)
+{
+    BB_BLOCK *next;
+
+    for (BB_BLOCK *b = pool->nodes; b; b = next) {
+        next = b->next;
+        free(b);
+    }
+    for (BB_BLOCK *b = pool->edges; b; b = next) {
+        next = b->next;
+        free(b);
+    }
+    pool->nodes = pool->edges = NULL;
+}
+
+// Returns the time in milliseconds since an arbitrary point, for the statistics
+static double msTime(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
 /*
  createCFG - Create the basic control flow graph
 
@@ -46,10 +110,13 @@ PBB createCFG(PPROC pProc)
     BB cfg;
     PBB psBB;
     PBB pBB = &cfg;
+    PBB *bbAt; // BB that starts at each icode, NULL if none
     PICODE pIcode = pProc->Icode.icode;
+    double time = msTime();
 
     cfg.next = NULL;
-    stats.numBBbef = stats.numBBaft = stats.numEdgesBef = stats.numEdgesAft = 0;
+    pProc->stats.numBBbef = pProc->stats.numBBaft = 0;
+    pProc->stats.numEdgesBef = pProc->stats.numEdgesAft = 0;
 
     for (ip = start = 0; ip < pProc->Icode.numIcode; ip++, pIcode++) {
         /* Stick a NOWHERE_NODE on the end if we terminate with anything
@@ -57,7 +124,7 @@ PBB createCFG(PPROC pProc)
         if (ip + 1 == pProc->Icode.numIcode && !(pIcode->ll.flg & TERMINATES) &&
             pIcode->ll.opcode != iJMP && pIcode->ll.opcode != iJMPF &&
             pIcode->ll.opcode != iRET && pIcode->ll.opcode != iRETF)
-            newBB(pBB, start, ip, NOWHERE_NODE, 0, pProc);
+            pBB = newBB(pBB, start, ip, NOWHERE_NODE, 0, pProc);
 
         // Only process icodes that have valid instructions
         else if ((pIcode->ll.flg & NO_CODE) != NO_CODE) {
@@ -99,22 +166,23 @@ PBB createCFG(PPROC pProc)
             case iJMPF:
             case iJMP:
                 if (pIcode->ll.flg & SWITCH) {
-                    pBB = newBB(pBB, start, ip, MULTI_BRANCH, pIcode->ll.caseTbl.numEntries,
-                                pProc);
-                    for (i = 0; i < pIcode->ll.caseTbl.numEntries; i++)
-                        pBB->edges[i].ip = pIcode->ll.caseTbl.entries[i];
+                    CASE_TBL *tbl = &icodeCaseTbl(&pProc->Icode, pIcode);
+
+                    pBB = newBB(pBB, start, ip, MULTI_BRANCH, tbl->numEntries, pProc);
+                    for (i = 0; i < tbl->numEntries; i++)
+                        pBB->edges[i].ip = tbl->entries[i];
                     pProc->hasCase = true;
                 } else if ((pIcode->ll.flg & (I | NO_LABEL)) == I) {
                     pBB = newBB(pBB, start, ip, ONE_BRANCH, 1, pProc);
                     pBB->edges[0].ip = pIcode->ll.immed.op;
                 } else
-                    newBB(pBB, start, ip, NOWHERE_NODE, 0, pProc);
+                    pBB = newBB(pBB, start, ip, NOWHERE_NODE, 0, pProc);
                 start = ip + 1;
                 break;
 
             case iCALLF:
             case iCALL: {
-                PPROC p = pIcode->ll.immed.proc.proc;
+                PPROC p = pIcode->ll.immed.proc;
                 if (p)
                     i = ((p->flg) & TERMINATES) ? 0 : 1;
                 else
@@ -127,7 +195,7 @@ PBB createCFG(PPROC pProc)
 
             case iRET:
             case iRETF:
-                newBB(pBB, start, ip, RETURN_NODE, 0, pProc);
+                pBB = newBB(pBB, start, ip, RETURN_NODE, 0, pProc);
                 start = ip + 1;
                 break;
 
@@ -148,6 +216,16 @@ PBB createCFG(PPROC pProc)
         }
     }
 
+    pProc->stats.bbTime = msTime() - time;
+    time = msTime();
+
+    // Map the icodes to the BBs that start at them
+    bbAt = memset(allocMem(pProc->Icode.numIcode * sizeof(PBB)), 0,
+                  pProc->Icode.numIcode * sizeof(PBB));
+    for (psBB = cfg.next; psBB; psBB = psBB->next)
+        if (!bbAt[psBB->start])
+            bbAt[psBB->start] = psBB;
+
     // Convert list of BBs into a graph
     for (pBB = cfg.next; pBB; pBB = pBB->next) {
         for (i = 0; i < pBB->numOutEdges; i++) {
@@ -155,25 +233,25 @@ PBB createCFG(PPROC pProc)
             if (ip >= SYNTHESIZED_MIN)
                 fatalError(INVALID_SYNTHETIC_BB);
             else {
-                for (psBB = cfg.next; psBB; psBB = psBB->next)
-                    if (psBB->start == ip) {
-                        pBB->edges[i].BBptr = psBB;
-                        psBB->numInEdges++;
-                        break;
-                    }
+                psBB = (ip < pProc->Icode.numIcode) ? bbAt[ip] : NULL;
                 if (!psBB)
                     fatalError(NO_BB, ip, pProc->name);
+                pBB->edges[i].BBptr = psBB;
+                psBB->numInEdges++;
             }
         }
     }
+
+    free(bbAt);
+    pProc->stats.edgeTime = msTime() - time;
     return cfg.next;
 }
 
 
-// newBB - Allocate new BB and link to end of list
+// newBB - Allocate new BB from the procedure's pool and link to end of list
 PBB newBB(PBB pBB, int start, int ip, uint8_t nodeType, int numOutEdges, PPROC pproc)
 {
-    PBB pnewBB = memset(allocStruc(BB), 0, sizeof(BB));
+    PBB pnewBB = memset(poolAlloc(&pproc->bbPool.nodes, sizeof(BB)), 0, sizeof(BB));
 
     pnewBB->nodeType = nodeType; // Initialise
     pnewBB->start = start;
@@ -184,7 +262,7 @@ PBB newBB(PBB pBB, int start, int ip, uint8_t nodeType, int numOutEdges, PPROC p
         pnewBB->loopFollow = NO_NODE;
 
     if (numOutEdges)
-        pnewBB->edges = allocMem(numOutEdges * sizeof(union typeAdr));
+        pnewBB->edges = poolAlloc(&pproc->bbPool.edges, numOutEdges * sizeof(union typeAdr));
 
     /* Mark the basic block to which the icodes belong to, but only for
        real code basic blocks (ie. not interval bbs) */
@@ -197,29 +275,13 @@ PBB newBB(PBB pBB, int start, int ip, uint8_t nodeType, int numOutEdges, PPROC p
     pBB->next = pnewBB;
 
     if (start != -1) { // Only for code BB's
-        stats.numBBbef++;
-        stats.numEdgesBef += numOutEdges;
+        pproc->stats.numBBbef++;
+        pproc->stats.numEdgesBef += numOutEdges;
     }
     return pnewBB;
 }
 
 
-// freeCFG - Deallocates a cfg
-void freeCFG(PBB cfg)
-{
-    PBB pBB;
-
-    for (pBB = cfg; pBB; pBB = cfg) {
-        if (pBB->inEdges)
-            free(pBB->inEdges);
-        if (pBB->edges)
-            free(pBB->edges);
-        cfg = pBB->next;
-        free(pBB);
-    }
-}
-
-
 // compressCFG - Remove redundancies and add in-edge information
 void compressCFG(PPROC pProc)
 {
@@ -244,29 +306,26 @@ void compressCFG(PPROC pProc)
     mergeFallThrough(pProc, pProc->cfg);
 
     // Remove redundant BBs created by the above compressions and allocate in-edge arrays as required.
-    stats.numEdgesAft = stats.numEdgesBef;
-    stats.numBBaft = stats.numBBbef;
+    pProc->stats.numEdgesAft = pProc->stats.numEdgesBef;
+    pProc->stats.numBBaft = pProc->stats.numBBbef;
 
     for (pBB = pProc->cfg; pBB; pBB = pNxt) {
         pNxt = pBB->next;
         if (pBB->numInEdges == 0) {
             if (pBB == pProc->cfg) // Init it misses out on
                 pBB->index = UN_INIT;
-            else {
-                if (pBB->numOutEdges)
-                    free(pBB->edges);
-                free(pBB);
-                stats.numBBaft--;
-                stats.numEdgesAft--;
+            else { // Its storage goes with the pool
+                pProc->stats.numBBaft--;
+                pProc->stats.numEdgesAft--;
             }
         } else {
             pBB->inEdgeCount = pBB->numInEdges;
-            pBB->inEdges = allocMem(pBB->numInEdges * sizeof(PBB));
+            pBB->inEdges = poolAlloc(&pProc->bbPool.edges, pBB->numInEdges * sizeof(PBB));
         }
     }
 
     // Allocate storage for dfsLast[] array
-    pProc->numBBs = stats.numBBaft;
+    pProc->numBBs = pProc->stats.numBBaft;
     pProc->dfsLast = allocMem(pProc->numBBs * sizeof(PBB));
 
     // Now do a dfs numbering traversal and fill in the inEdges[] array
@@ -302,7 +361,6 @@ static PBB rmJMP(PPROC pProc, int marker, PBB pBB)
                 }
             } while (pBB->nodeType != NOWHERE_NODE);
 
-            free(pBB->edges);
             pBB->numOutEdges = 0;
             pBB->edges = NULL;
         }
@@ -340,7 +398,6 @@ static void mergeFallThrough(PPROC pProc, PBB pBB)
             pBB->length = pChild->start + pChild->length - pBB->start;
             pProc->Icode.icode[pChild->start].ll.flg &= ~TARGET;
             pBB->numOutEdges = pChild->numOutEdges;
-            free(pBB->edges);
             pBB->edges = pChild->edges;
 
             pChild->numOutEdges = pChild->numInEdges = 0;
@@ -116,6 +116,10 @@ typedef struct _BB {
     int dfsFirstNum;  // DFS #: first visit of node
     int dfsLastNum;   // DFS #: last visit of node
     int immedDom;     // Immediate dominator (dfsLast index)
+    int domChild;     // First node it immediately dominates (dfsLast index)
+    int domSibling;   // Next node with the same immediate dominator (dfsLast index)
+    int domPre;       // Preorder number in the dominator tree, -1 if not in it
+    int domPost;      // Postorder number in the dominator tree, -1 if not in it
     int ifFollow;     // node that ends the if
     int loopType;     // Type of loop (if any)
     int latchNode;    // latching node of the loop
@@ -125,11 +129,18 @@ typedef struct _BB {
     int caseHead;     // most nested case to which this node belongs (dfsLast)
     int caseTail;     // tail node for the case
 
+    // For code generation
+    int codeIdx;      // Index into cCode.code of the code of the first icode
+    int hllLabNum;    // label # for hll codegen, if the first icode has HLL_LABEL
+
     int index;        // Index, used in several ways
     struct _BB *next; // Next (list link)
 } BB;
 typedef BB *PBB;
 
+// Node a dominates node b (see domtree.c)
+#define dominates(a, b) (((a)->domPre <= (b)->domPre) && ((b)->domPost <= (a)->domPost))
+
 // Derived Sequence structure
 typedef struct _derivedNode {
     BB *Gi;                    // Graph pointer
@@ -137,5 +148,12 @@ typedef struct _derivedNode {
     struct _derivedNode *next; // Next derived graph
 } derSeq;
 
+// Pool of the BBs of a procedure's graphs and of their edges, released in bulk (see graph.c)
+typedef struct _bbBlock BB_BLOCK;
+typedef struct {
+    BB_BLOCK *nodes; // Blocks of BBs, most recent first
+    BB_BLOCK *edges; // Blocks of out and in edge arrays, most recent first
+} BB_POOL;
+
 #endif // GRAPH_H
 
@@ -23,7 +23,8 @@
 #include <malloc.h>
 #include <string.h>
 
-#define ICODE_DELTA 25;
+#define ICODE_INIT 16      // Initial # icodes allocated for a procedure
+#define LABEL_IDX_INIT 64 // Initial # slots in the label index
 
 // Masks off bits set by duReg[]
 uint32_t maskDuReg[] = { 0x00,     0xFEEFFE, 0xFDDFFD, 0xFBB00B, 0xF77007, // word regs
@@ -34,63 +35,168 @@ uint32_t maskDuReg[] = { 0x00,     0xFEEFFE, 0xFDDFFD, 0xFBB00B, 0xF77007, // wo
                          0xFFFFB7, 0xFFFF77, 0xFFFF9F, 0xFFFF5F,           // index regs
                          0xFFFFBF, 0xFFFF7F, 0xFFFFDF, 0xFFFFF7 };
 
-static char buf[lineSize]; // Line buffer for hl icode output
+struct _hl noHlIcode; // What icodeHl() reads for icodes that are not HIGH_LEVEL
 
 
+/*
+ Makes room for at least n icodes in the icode array. The array is reallocated only if it
+ is smaller; reallocations and the bytes of icode they move are counted in stats.
+*/
+void reserveIcode(ICODE_REC *icode, int n)
+{
+    if (n <= icode->alloc)
+        return;
+
+    if (icode->icode) {
+        stats.numIcodeReallocs++;
+        stats.numIcodeBytesMoved += icode->numIcode * sizeof(ICODE);
+    }
+    icode->alloc = n;
+    icode->icode = allocVar(icode->icode, icode->alloc * sizeof(ICODE));
+}
+
+/*
+ Releases the label index of an icode array and shrinks the array to the icodes in use, once
+ icodes are neither added to it nor searched by label any more.
+*/
+void packIcode(ICODE_REC *icode)
+{
+    free(icode->labelIdx);
+    icode->labelIdx = NULL;
+    icode->labelAlloc = 0;
+
+    if (icode->numIcode && icode->numIcode < icode->alloc) {
+        icode->alloc = icode->numIcode;
+        icode->icode = allocVar(icode->icode, icode->alloc * sizeof(ICODE));
+    }
+}
+
+/*
+ Adds a case table of numEntries entries, not yet filled in, to the icode array and returns
+ its index, which the SWITCH icode keeps in ll.caseIdx.
+*/
+int newCaseTbl(ICODE_REC *icode, int numEntries)
+{
+    icode->caseTbl = allocVar(icode->caseTbl, (icode->numCaseTbl + 1) * sizeof(CASE_TBL));
+
+    CASE_TBL *tbl = &icode->caseTbl[icode->numCaseTbl];
+    tbl->numEntries = numEntries;
+    tbl->entries = allocMem(numEntries * sizeof(uint32_t));
+    return icode->numCaseTbl++;
+}
+
+/*
+ Enters icode idx in the label index of the icode array. Only the first icode with a given
+ label is entered, as several synthetic icodes may share the label of the original instruction.
+*/
+static void insertLabelIdx(ICODE_REC *icode, int idx)
+{
+    uint32_t mask = icode->labelAlloc - 1;
+    uint32_t label = icode->icode[idx].ll.label;
+    uint32_t h;
+
+    for (h = HASH(label, mask); icode->labelIdx[h] != -1; h = (h + 1) & mask)
+        if (icode->icode[icode->labelIdx[h]].ll.label == label)
+            return;
+    icode->labelIdx[h] = idx;
+}
+
+// Doubles the label index (keeping it at most half full) and rehashes the icodes into it
+static void growLabelIdx(ICODE_REC *icode)
+{
+    icode->labelAlloc = icode->labelAlloc ? icode->labelAlloc * 2 : LABEL_IDX_INIT;
+    free(icode->labelIdx);
+    icode->labelIdx = allocMem(icode->labelAlloc * sizeof(int));
+    memset(icode->labelIdx, -1, icode->labelAlloc * sizeof(int));
+
+    for (int i = 0; i < icode->numIcode; i++)
+        insertLabelIdx(icode, i);
+}
+
 /*
  Copies the icode that is pointed to by pIcode to the icode array.
  If there is need to allocate extra memory, it is done so, and the icode.alloc variable is adjusted.
+ The label index is kept up to date with the new icode.
 */
 PICODE newIcode(ICODE_REC *icode, PICODE pIcode)
 {
-    if (icode->numIcode == icode->alloc) {
-        icode->alloc += ICODE_DELTA;
-        icode->icode = allocVar(icode->icode, icode->alloc * sizeof(ICODE));
-    }
+    if (icode->numIcode == icode->alloc)
+        reserveIcode(icode, icode->alloc ? icode->alloc * 2 : ICODE_INIT);
 
     PICODE resIcode = memcpy(&icode->icode[icode->numIcode], pIcode, sizeof(ICODE));
     icode->numIcode++;
+
+    if (icode->numIcode * 2 > icode->labelAlloc)
+        growLabelIdx(icode); // Also enters the new icode
+    else
+        insertLabelIdx(icode, icode->numIcode - 1);
+
     return resIcode;
 }
 
+/*
+ labelSrch - Searches the label index of the icode array for the first instruction with
+ label = target, and replaces *pIndex with its icode index
+*/
+bool labelSrch(ICODE_REC *icode, uint32_t target, int *pIndex)
+{
+    if (!icode->labelAlloc)
+        return false;
+
+    uint32_t mask = icode->labelAlloc - 1;
+
+    for (uint32_t h = HASH(target, mask); icode->labelIdx[h] != -1; h = (h + 1) & mask)
+        if (icode->icode[icode->labelIdx[h]].ll.label == target) {
+            *pIndex = icode->labelIdx[h];
+            return true;
+        }
+    return false;
+}
+
+// Makes pIcode HIGH_LEVEL, giving it a HIGH_LEVEL part from the current arena if it has none
+static void toHighLevel(PICODE pIcode)
+{
+    pIcode->type = HIGH_LEVEL;
+    if (pIcode->hl == NULL)
+        pIcode->hl = allocHlPart();
+}
+
 // Places the new ASSIGN high-level operand in the high-level icode array
 void newAsgnHlIcode(PICODE pIcode, COND_EXPR *lhs, COND_EXPR *rhs)
 {
-    pIcode->type = HIGH_LEVEL;
-    pIcode->hl.opcode = ASSIGN;
-    pIcode->hl.oper.asgn.lhs = lhs;
-    pIcode->hl.oper.asgn.rhs = rhs;
+    toHighLevel(pIcode);
+    icodeHl(pIcode).opcode = ASSIGN;
+    icodeHl(pIcode).oper.asgn.lhs = lhs;
+    icodeHl(pIcode).oper.asgn.rhs = rhs;
 }
 
 // Places the new CALL high-level operand in the high-level icode array
 void newCallHlIcode(PICODE pIcode)
 {
-    pIcode->type = HIGH_LEVEL;
-    pIcode->hl.opcode = CALL;
-    pIcode->hl.oper.call.proc = pIcode->ll.immed.proc.proc;
-    pIcode->hl.oper.call.args = allocMem(sizeof(STKFRAME));
-    memset(pIcode->hl.oper.call.args, 0, sizeof(STKFRAME));
-
-    if (pIcode->ll.immed.proc.cb != 0)
-        pIcode->hl.oper.call.args->cb = pIcode->ll.immed.proc.cb;
-    else
-        pIcode->hl.oper.call.args->cb = pIcode->hl.oper.call.proc->cbParam;
+    toHighLevel(pIcode);
+    icodeHl(pIcode).opcode = CALL;
+    icodeHl(pIcode).oper.call.proc = pIcode->ll.immed.proc;
+    icodeHl(pIcode).oper.call.args = allocMem(sizeof(STKFRAME));
+    memset(icodeHl(pIcode).oper.call.args, 0, sizeof(STKFRAME));
+
+    // When 0, the callee's # bytes of parameters is set by setCallConv()
+    icodeHl(pIcode).oper.call.args->cb = pIcode->ll.cb;
 }
 
 // Places the new POP/PUSH/RET high-level operand in the high-level icode array
 void newUnaryHlIcode(PICODE pIcode, hlIcode op, COND_EXPR *exp)
 {
-    pIcode->type = HIGH_LEVEL;
-    pIcode->hl.opcode = op;
-    pIcode->hl.oper.exp = exp;
+    toHighLevel(pIcode);
+    icodeHl(pIcode).opcode = op;
+    icodeHl(pIcode).oper.exp = exp;
 }
 
 // Places the new JCOND high-level operand in the high-level icode array
 void newJCondHlIcode(PICODE pIcode, COND_EXPR *cexp)
 {
-    pIcode->type = HIGH_LEVEL;
-    pIcode->hl.opcode = JCOND;
-    pIcode->hl.oper.exp = cexp;
+    toHighLevel(pIcode);
+    icodeHl(pIcode).opcode = JCOND;
+    icodeHl(pIcode).oper.exp = cexp;
 }
 
 /*
@@ -103,13 +209,14 @@ void invalidateIcode(PICODE pIcode) { pIcode->invalid = true; }
  Removes the defined register regi from the lhs subtree. If all registers of this instruction
  are unused, the instruction is invalidated (ie. removed)
 */
-bool removeDefRegi(uint8_t regi, PICODE picode, int thisDefIdx, LOCAL_ID *locId)
+bool removeDefRegi(uint8_t regi, ICODE_REC *icode, PICODE picode, int thisDefIdx,
+                   LOCAL_ID *locId)
 {
-    int numDefs = picode->du1.numRegsDef;
+    int numDefs = picode->numRegsDef;
 
     if (numDefs == thisDefIdx)
         for (; numDefs > 0; numDefs--) {
-            if ((picode->du1.idx[numDefs - 1][0] != 0) || (picode->du.lastDefRegi))
+            if ((icodeDu1(icode, picode).idx[numDefs - 1][0] != 0) || (picode->du.lastDefRegi))
                 break;
         }
 
@@ -117,17 +224,17 @@ bool removeDefRegi(uint8_t regi, PICODE picode, int thisDefIdx, LOCAL_ID *locId)
         invalidateIcode(picode);
         return true;
     } else {
-        switch (picode->hl.opcode) {
+        switch (icodeHl(picode).opcode) {
         default: break;
         case ASSIGN:
-            removeRegFromLong(regi, locId, picode->hl.oper.asgn.lhs);
-            picode->du1.numRegsDef--;
+            removeRegFromLong(regi, locId, icodeHl(picode).oper.asgn.lhs);
+            picode->numRegsDef--;
             picode->du.def &= maskDuReg[regi];
             break;
         case POP:
         case PUSH:
-            removeRegFromLong(regi, locId, picode->hl.oper.exp);
-            picode->du1.numRegsDef--;
+            removeRegFromLong(regi, locId, icodeHl(picode).oper.exp);
+            picode->numRegsDef--;
             picode->du.def &= maskDuReg[regi];
             break;
         }
@@ -348,103 +455,77 @@ void inverseCondOp(COND_EXPR **exp)
     // other types are left unmodified
 }
 
-// Returns the string that represents the procedure call of tproc (ie. with actual parameters)
-char *writeCall(PPROC tproc, PSTKFRAME args, PPROC pproc, int *numLoc)
+// Appends the procedure call of tproc (ie. with actual parameters) to sb
+void writeCall(strBuf *sb, PPROC tproc, PSTKFRAME args, PPROC pproc, int *numLoc)
 {
-    char *s = allocMem(100 * sizeof(char));
-    s[0] = '\0';
-    sprintf(s, "%s (", tproc->name);
+    appendStrBuf(sb, "%s (", tproc->name);
 
     for (int i = 0; i < args->csym; i++) {
-        char *condExp = walkCondExpr(args->sym[i].actual, pproc, numLoc);
-        strcat(s, condExp);
+        walkCondExpr(sb, args->sym[i].actual, pproc, numLoc);
         if (i < (args->csym - 1))
-            strcat(s, ", ");
+            appendStrBuf(sb, ", ");
     }
 
-    strcat(s, ")");
-
-    return s;
+    appendStrBuf(sb, ")");
 }
 
-// Displays the output of a JCOND icode.
-char *writeJcond(struct _hl h, PPROC pProc, int *numLoc)
+// Appends the output of a JCOND icode to sb.
+void writeJcond(strBuf *sb, struct _hl h, PPROC pProc, int *numLoc)
 {
-    memset(buf, ' ', sizeof(buf));
-    buf[0] = '\0';
-    strcat(buf, "if ");
+    appendStrBuf(sb, "if ");
     inverseCondOp(&h.oper.exp);
-    char *e = walkCondExpr(h.oper.exp, pProc, numLoc);
-    strcat(buf, e);
-    strcat(buf, " {\n");
-
-    return buf;
+    walkCondExpr(sb, h.oper.exp, pProc, numLoc);
+    appendStrBuf(sb, " {\n");
 }
 
 /*
- Displays the inverse output of a JCOND icode. This is used in the case when the THEN clause
+ Appends the inverse output of a JCOND icode to sb. This is used in the case when the THEN clause
  of an if..then..else is empty. The clause is negated and the ELSE clause is used instead.
 */
-char *writeJcondInv(struct _hl h, PPROC pProc, int *numLoc)
+void writeJcondInv(strBuf *sb, struct _hl h, PPROC pProc, int *numLoc)
 {
-    memset(buf, ' ', sizeof(buf));
-    buf[0] = '\0';
-    strcat(buf, "if ");
-    char *e = walkCondExpr(h.oper.exp, pProc, numLoc);
-    strcat(buf, e);
-    strcat(buf, " {\n");
-
-    return buf;
+    appendStrBuf(sb, "if ");
+    walkCondExpr(sb, h.oper.exp, pProc, numLoc);
+    appendStrBuf(sb, " {\n");
 }
 
-/*
- Returns a string with the contents of the current high-level icode.
- Note: this routine does not output the contens of JCOND icodes. This is done in a separate routine
- to be able to support the removal of empty THEN clauses on an if..then..else.
-*/
-char *write1HlIcode(struct _hl h, PPROC pProc, int *numLoc)
+// Appends the output of a HIGH_LEVEL icode to sb; nothing for icodes that generate no code.
+void write1HlIcode(strBuf *sb, struct _hl h, PPROC pProc, int *numLoc)
 {
-    char *e;
-    memset(buf, ' ', sizeof(buf));
-    buf[0] = '\0';
+    int start = sb->len, mark;
 
     switch (h.opcode) {
     default: break;
     case ASSIGN:
-        e = walkCondExpr(h.oper.asgn.lhs, pProc, numLoc);
-        strcat(buf, e);
-        strcat(buf, " = ");
-        e = walkCondExpr(h.oper.asgn.rhs, pProc, numLoc);
-        strcat(buf, e);
-        strcat(buf, ";\n");
+        walkCondExpr(sb, h.oper.asgn.lhs, pProc, numLoc);
+        appendStrBuf(sb, " = ");
+        walkCondExpr(sb, h.oper.asgn.rhs, pProc, numLoc);
+        appendStrBuf(sb, ";\n");
         break;
     case CALL:
-        e = writeCall(h.oper.call.proc, h.oper.call.args, pProc, numLoc);
-        strcat(buf, e);
-        strcat(buf, ";\n");
+        writeCall(sb, h.oper.call.proc, h.oper.call.args, pProc, numLoc);
+        appendStrBuf(sb, ";\n");
         break;
     case RET:
-        e = walkCondExpr(h.oper.exp, pProc, numLoc);
-        if (e[0] != '\0') {
-            strcat(buf, "return (");
-            strcat(buf, e);
-            strcat(buf, ");\n");
-        }
+        appendStrBuf(sb, "return (");
+        mark = sb->len;
+        walkCondExpr(sb, h.oper.exp, pProc, numLoc);
+        if (sb->len == mark) // No return value
+            truncStrBuf(sb, start);
+        else
+            appendStrBuf(sb, ");\n");
         break;
     case POP:
-        strcat(buf, "POP ");
-        e = walkCondExpr(h.oper.exp, pProc, numLoc);
-        strcat(buf, e);
-        strcat(buf, "\n");
+        appendStrBuf(sb, "POP ");
+        walkCondExpr(sb, h.oper.exp, pProc, numLoc);
+        appendStrBuf(sb, "\n");
         break;
     case PUSH:
-        strcat(buf, "PUSH ");
-        e = walkCondExpr(h.oper.exp, pProc, numLoc);
-        strcat(buf, e);
-        strcat(buf, "\n");
+        appendStrBuf(sb, "PUSH ");
+        walkCondExpr(sb, h.oper.exp, pProc, numLoc);
+        appendStrBuf(sb, "\n");
         break;
     }
-    return buf;
 }
 
 // Returns the value of 2 to the power of i
@@ -456,10 +537,11 @@ int power2(int i)
     return (2 << (i - 1));
 }
 
-// Writes the registers/stack variables that are used and defined by this instruction.
-void writeDU(PICODE pIcode, int idx)
+// Writes the registers/stack variables that are used and defined by instruction idx of icode.
+void writeDU(ICODE_REC *icode, int idx)
 {
     static char buf[100];
+    PICODE pIcode = &icode->icode[idx];
 
     memset(buf, ' ', sizeof(buf));
     buf[0] = '\0';
@@ -488,41 +570,22 @@ void writeDU(PICODE pIcode, int idx)
         printf("Use (reg) = %s\n", buf);
 
     // Print du1 chain
-    printf("# regs defined = %d\n", pIcode->du1.numRegsDef);
+    printf("# regs defined = %d\n", pIcode->numRegsDef);
 
     for (int i = 0; i < MAX_REGS_DEF; i++)
-        if (pIcode->du1.idx[i][0] != 0) {
+        if (icodeDu1(icode, pIcode).idx[i][0] != 0) {
             printf("%d: du1[%d][] = ", idx, i);
             for (int j = 0; j < MAX_USES; j++) {
-                if (pIcode->du1.idx[i][j] == 0)
+                if (icodeDu1(icode, pIcode).idx[i][j] == 0)
                     break;
-                printf("%d ", pIcode->du1.idx[i][j]);
+                printf("%d ", icodeDu1(icode, pIcode).idx[i][j]);
             }
             printf("\n");
         }
 
     // For CALL, print # parameter bytes
-    if (pIcode->hl.opcode == CALL)
-        printf("# param bytes = %d\n", pIcode->hl.oper.call.args->cb);
+    if (icodeHl(pIcode).opcode == CALL)
+        printf("# param bytes = %d\n", icodeHl(pIcode).oper.call.args->cb);
     printf("\n");
 }
 
-// Frees the storage allocated to h->hlIcode
-void freeHlIcode(PICODE icode, int numIcodes)
-{
-    for (int i = 0; i < numIcodes; i++) {
-        struct _hl h = icode[i].hl;
-        switch (h.opcode) {
-        default: break;
-        case ASSIGN:
-            freeCondExpr(h.oper.asgn.lhs);
-            freeCondExpr(h.oper.asgn.rhs);
-            break;
-        case POP:
-        case PUSH:
-        case JCOND:
-            freeCondExpr(h.oper.exp);
-            break;
-        }
-    }
-}
@@ -257,14 +257,16 @@ typedef struct {
     uint32_t use;         // For Registers: position in dword is reg index
 } DU_ICODE;
 
-// Definition-use chain for level 1 (within a basic block)
+/*
+ Definition-use chain for level 1 (within a basic block). The uses are icode indices, which fit
+ in 16 bits as a procedure lies within one code segment.
+*/
 #define MAX_REGS_DEF 2 // 2 regs def'd for long-reg vars
 #define MAX_USES 5
 
 typedef struct {
-    int numRegsDef;                  // # registers defined by this inst
-    uint8_t regi[MAX_REGS_DEF];      // registers defined by this inst
-    int idx[MAX_REGS_DEF][MAX_USES]; // inst that uses this def
+    uint8_t regi[MAX_REGS_DEF];           // registers defined by this inst
+    uint16_t idx[MAX_REGS_DEF][MAX_USES]; // inst that uses this def
 } DU1;
 
 // LOW_LEVEL icode operand record
@@ -285,58 +287,84 @@ typedef enum {
 } opLoc;
 
 
-// Icode definition: LOW_LEVEL and HIGH_LEVEL
+/*
+ HIGH_LEVEL part of an icode. It is allocated from the procedure's expression arena when the
+ icode becomes HIGH_LEVEL (see newAsgnHlIcode), and released with it.
+*/
+struct _hl {
+    hlIcode opcode;                     // hlIcode opcode
+    union {                             // different operands
+        struct {                        // for ASSIGN
+            COND_EXPR *lhs;
+            COND_EXPR *rhs;
+        } asgn;
+        COND_EXPR *exp;                 // for JCOND, RET, PUSH, POP
+        struct {                        // for CALL
+            struct _proc *proc;
+            struct _STKFRAME *args;     // actual arguments
+        } call;
+    } oper;                             // operand
+};
+
+// Case table of a SWITCH icode, kept in the side table of its ICODE_REC
 typedef struct {
-    icodeType type;                     // Icode type
+    int numEntries;                     // # entries in case table
+    uint32_t *entries;                  // array of offsets
+} CASE_TBL;
+
+/*
+ Icode definition: LOW_LEVEL and HIGH_LEVEL. The enumerated fields are held in bytes, and the
+ case tables, def/use chains and HIGH_LEVEL operands are kept apart, to keep the record small.
+*/
+typedef struct {
+    uint8_t type;                       // Icode type (icodeType)
     bool invalid;                       // Has no HIGH_LEVEL equivalent
-    struct _BB *inBB;                   // BB to which this icode belongs
+    int8_t numRegsDef;                  // # registers defined by this inst
     DU_ICODE du;                        // Def/use regs/vars
-    DU1 du1;                            // du chain 1
-    int codeIdx;                        // Index into cCode.code
+    struct _BB *inBB;                   // BB to which this icode belongs
+    struct _hl *hl;                     // HIGH_LEVEL part, NULL until the icode becomes one
 
     struct {                            // For LOW_LEVEL icodes
-        llIcode opcode;                 // llIcode instruction
-        uint8_t numBytes;               // Number of bytes this instr
         uint32_t flg;                   // icode flags
         uint32_t label;                 // offset in image (20-bit adr)
         ICODEMEM dst;                   // destination operand
         ICODEMEM src;                   // source operand
+        uint8_t opcode;                 // llIcode instruction
+        uint8_t numBytes;               // Number of bytes this instr
+        DU flagDU;                      // def/use of flags
+        uint16_t caseIdx;               /* Index of the case table if SWITCH, case # if CASE,
+                                           symbol index if SYM_USE or SYM_DEF */
+        uint16_t cb;                    // # actual arg bytes (for CALL(F))
         union {                         // Source operand if (flg & I)
             uint32_t op;                // idx of immed src op
-            struct {                    // Call & # actual arg bytes
-                struct _proc *proc;     // ^ target proc (for CALL(F))
-                int cb;                 // # actual arg bytes
-            } proc;
+            struct _proc *proc;         // ^ target proc (for CALL(F))
         } immed;
-        DU flagDU;                      // def/use of flags
-        struct {                        // Case table if op==JMP && !I
-            int numEntries;             // # entries in case table
-            uint32_t *entries;          // array of offsets
-        } caseTbl;
-        int hllLabNum;                  // label # for hll codegen
     } ll;
-
-    struct _hl {                        // For HIGH_LEVEL icodes
-        hlIcode opcode;                 // hlIcode opcode
-        union {                         // different operands
-            struct {                    // for ASSIGN
-                COND_EXPR *lhs;
-                COND_EXPR *rhs;
-            } asgn;
-            COND_EXPR *exp;             // for JCOND, RET, PUSH, POP
-            struct {                    // for CALL
-                struct _proc *proc;
-                struct _STKFRAME *args; // actual arguments
-            } call;
-        } oper;                         // operand
-    } hl;
 } ICODE;
 typedef ICODE *PICODE;
 
-typedef struct {  // Icode array info
-    int numIcode; // # icodes in use
-    int alloc;    // # icodes allocated
-    ICODE *icode; // Array of icodes
+/*
+ HIGH_LEVEL part of icode p. An icode that is not HIGH_LEVEL reads as a cleared record, which
+ must not be written.
+*/
+extern struct _hl noHlIcode;
+#define icodeHl(p) (*((p)->hl ? (p)->hl : &noHlIcode))
+
+// Def/use chain of the icode p of the icode array rec, while rec.du1 is allocated (see genDU1)
+#define icodeDu1(rec, p) ((rec)->du1[(p) - (rec)->icode])
+
+// Case table of the SWITCH icode p of the icode array rec
+#define icodeCaseTbl(rec, p) ((rec)->caseTbl[(p)->ll.caseIdx])
+
+typedef struct {     // Icode array info
+    int numIcode;    // # icodes in use
+    int alloc;       // # icodes allocated
+    ICODE *icode;    // Array of icodes
+    DU1 *du1;        // Def/use chains of the icodes, NULL outside data flow analysis and -v
+    CASE_TBL *caseTbl; // Case tables of the SWITCH icodes, see newCaseTbl
+    int numCaseTbl;  // # case tables in caseTbl
+    int labelAlloc;  // # slots in the label index (power of 2)
+    int *labelIdx;   // Hashed label => icode index, -1 if empty slot
 } ICODE_REC;
 
 #endif // ICODE_H
@@ -24,6 +24,10 @@
 #include <stdlib.h>
 #include <string.h>
 
+/* Sets flags of the procedure being analysed. Its callers may be analysed at the same time,
+   and read its flags (see findIdioms). */
+#define setProcFlg(pProc, f) __atomic_fetch_or(&(pProc)->flg, (f), __ATOMIC_RELAXED)
+
 // JmpInst - Returns TRUE if opcode is a conditional or unconditional jump
 bool JmpInst(llIcode opcode)
 {
@@ -58,6 +62,23 @@ bool JmpInst(llIcode opcode)
     return false;
 }
 
+/*
+ Records that the procedure proc, called or analysed by pProc, has calling convention flg with
+ cb bytes of parameters. This is applied to proc by setCallConv(pProc).
+*/
+static void addCallConv(PPROC pProc, PPROC proc, int16_t cb, uint32_t flg)
+{
+    if (pProc->numCallConv == pProc->allocCallConv) {
+        pProc->allocCallConv = pProc->allocCallConv ? pProc->allocCallConv * 2 : 4;
+        pProc->callConv = allocVar(pProc->callConv, pProc->allocCallConv * sizeof(CALL_CONV));
+    }
+
+    CALL_CONV *conv = &pProc->callConv[pProc->numCallConv++];
+    conv->proc = proc;
+    conv->cb = cb;
+    conv->flg = flg;
+}
+
 /*
  checkStkVars - Checks for PUSH SI
                            [PUSH DI]
@@ -70,22 +91,22 @@ static int checkStkVars(PICODE pIcode, PICODE pEnd, PPROC pProc)
     // Look for PUSH SI
     if (pIcode < pEnd) {
         if ((pIcode->ll.opcode == iPUSH) && (pIcode->ll.dst.regi == rSI)) {
-            pProc->flg |= SI_REGVAR;
+            setProcFlg(pProc, SI_REGVAR);
 
             // Look for PUSH DI
             if (++pIcode < pEnd && (pIcode->ll.opcode == iPUSH) &&
                 (pIcode->ll.dst.regi == rDI)) {
-                pProc->flg |= DI_REGVAR;
+                setProcFlg(pProc, DI_REGVAR);
                 return 2;
             } else
                 return 1;
         } else if ((pIcode->ll.opcode == iPUSH) && (pIcode->ll.dst.regi == rDI)) {
-            pProc->flg |= DI_REGVAR;
+            setProcFlg(pProc, DI_REGVAR);
 
             // Look for PUSH SI
             if ((++pIcode < pEnd) && (pIcode->ll.opcode == iPUSH) &&
                 (pIcode->ll.dst.regi == rSI)) {
-                pProc->flg |= SI_REGVAR;
+                setProcFlg(pProc, SI_REGVAR);
                 return 2;
             } else
                 return 1;
@@ -121,7 +142,7 @@ static int idiom1(PICODE pIcode, PICODE pEnd, PPROC pProc)
             pIcode->ll.opcode == iMOV && pIcode->ll.dst.regi == rBP &&
             pIcode->ll.src.regi == rSP) {
             pProc->args.minOff = 2;
-            pProc->flg |= PROC_IS_HLL;
+            setProcFlg(pProc, PROC_IS_HLL);
 
             // Look for SUB SP, immed
             if ((++pIcode < pEnd) && (pIcode->ll.flg & (I | TARGET | CASE)) == I &&
@@ -298,10 +319,8 @@ static void idiom4(PICODE pIcode, PICODE pEnd, PPROC pProc)
         popStkVars(pIcode - 2, pEnd, pProc);
 
     // Check for RET(F) immed
-    if (pIcode->ll.flg & I) {
-        pProc->cbParam = (int16_t)pIcode->ll.immed.op;
-        pProc->flg |= CALL_PASCAL;
-    }
+    if (pIcode->ll.flg & I)
+        addCallConv(pProc, pProc, (int16_t)pIcode->ll.immed.op, CALL_PASCAL);
 }
 
 /*
@@ -519,7 +538,7 @@ static void idiom10(PICODE pIcode, PICODE pEnd)
                 pIcode->ll.flg |= I;
                 pIcode->ll.immed.op = 0;
                 pIcode->du.def = 0;
-                pIcode->du1.numRegsDef = 0;
+                pIcode->numRegsDef = 0;
             }
     }
 }
@@ -811,6 +830,7 @@ void findIdioms(PPROC pProc)
     COND_EXPR *exp;       // Pointer to temporal expression
     int idx;              // Index into local identifier table
     uint8_t regH, regL;   // High and low registers for long word reg
+    uint32_t flg;         // Flags of the procedure called
 
     pIcode = pProc->Icode.icode;
     pEnd = pIcode + pProc->Icode.numIcode;
@@ -866,7 +886,7 @@ void findIdioms(PPROC pProc)
 
         case iPUSH: // Idiom 1
             if ((!(pProc->flg & PROC_HLL)) && (idx = idiom1(pIcode, pEnd, pProc))) {
-                pProc->flg |= PROC_HLL;
+                setProcFlg(pProc, PROC_HLL);
                 for (; idx > 0; idx--) {
                     invalidateIcode(pIcode++);
                     ip++;
@@ -896,7 +916,7 @@ void findIdioms(PPROC pProc)
             {
                 lhs = idCondExpReg(idx, 0, &pProc->localId);
                 setRegDU(pIcode, idx, DEF);
-                pIcode->du1.numRegsDef--; // prev byte reg def
+                pIcode->numRegsDef--; // prev byte reg def
                 rhs = idCondExp(pIcode, SRC, pProc, ip, pIcode, NONE);
                 newAsgnHlIcode(pIcode, lhs, rhs);
                 invalidateIcode(pIcode + 1);
@@ -910,10 +930,10 @@ void findIdioms(PPROC pProc)
         case iCALLF:
             /* Check for library functions that return a long register.
                Propagate this result */
-            if ((pIcode->ll.immed.proc.proc->flg & PROC_ISLIB) &&
-                (pIcode->ll.immed.proc.proc->flg & PROC_IS_FUNC)) {
-                if ((pIcode->ll.immed.proc.proc->retVal.type == TYPE_LONG_SIGN) ||
-                    (pIcode->ll.immed.proc.proc->retVal.type == TYPE_LONG_UNSIGN))
+            flg = __atomic_load_n(&pIcode->ll.immed.proc->flg, __ATOMIC_RELAXED);
+            if ((flg & PROC_ISLIB) && (flg & PROC_IS_FUNC)) {
+                if ((pIcode->ll.immed.proc->retVal.type == TYPE_LONG_SIGN) ||
+                    (pIcode->ll.immed.proc->retVal.type == TYPE_LONG_UNSIGN))
                     newLongRegId(&pProc->localId, TYPE_LONG_SIGN, rDX, rAX, ip);
             }
 
@@ -921,9 +941,8 @@ void findIdioms(PPROC pProc)
             if ((idx = idiom3(pIcode, pEnd))) // idiom 3
             {
                 if (pIcode->ll.flg & I) {
-                    (pIcode->ll.immed.proc.proc)->cbParam = (int16_t)idx;
-                    pIcode->ll.immed.proc.cb = idx;
-                    (pIcode->ll.immed.proc.proc)->flg |= CALL_C;
+                    addCallConv(pProc, pIcode->ll.immed.proc, (int16_t)idx, CALL_C);
+                    pIcode->ll.cb = idx;
                     pIcode++;
                     invalidateIcode(pIcode++);
                     ip++;
@@ -931,9 +950,8 @@ void findIdioms(PPROC pProc)
             } else if ((idx = idiom17(pIcode, pEnd))) // idiom 17
             {
                 if (pIcode->ll.flg & I) {
-                    (pIcode->ll.immed.proc.proc)->cbParam = (int16_t)idx;
-                    pIcode->ll.immed.proc.cb = idx;
-                    (pIcode->ll.immed.proc.proc)->flg |= CALL_C;
+                    addCallConv(pProc, pIcode->ll.immed.proc, (int16_t)idx, CALL_C);
+                    pIcode->ll.cb = idx;
                     ip += idx / 2 - 1;
                     pIcode++;
                     for (idx /= 2; idx > 0; idx--)
@@ -1069,7 +1087,7 @@ void findIdioms(PPROC pProc)
 
         case iENTER: // ENTER is equivalent to init PUSH bp
             if (ip == 0)
-                pProc->flg |= (PROC_HLL | PROC_IS_HLL);
+                setProcFlg(pProc, (PROC_HLL | PROC_IS_HLL));
             pIcode++;
             break;
 
@@ -1102,10 +1120,7 @@ void findIdioms(PPROC pProc)
     if ((pProc->flg & PROC_HLL) && (pProc->args.csym)) {
         pProc->args.minOff += (pProc->flg & PROC_FAR ? 4 : 2);
         int16_t delta = pProc->args.maxOff - pProc->args.minOff;
-        if (pProc->cbParam != delta) {
-            pProc->cbParam = delta;
-            pProc->flg |= (CALL_MASK & CALL_UNKNOWN);
-        }
+        addCallConv(pProc, pProc, delta, CALL_MASK & CALL_UNKNOWN);
     }
 }
 
@@ -1126,7 +1141,7 @@ void bindIcodeOff(PPROC pProc)
     // Flag all jump targets for BB construction and disassembly stage 2
     for (int i = 0; i < pProc->Icode.numIcode; i++)
         if ((pIcode[i].ll.flg & I) && JmpInst(pIcode[i].ll.opcode)) {
-            if (labelSrch(pIcode, pProc->Icode.numIcode, pIcode[i].ll.immed.op, &j))
+            if (labelSrch(&pProc->Icode, pIcode[i].ll.immed.op, &j))
                 pIcode[j].ll.flg |= TARGET;
         }
 
@@ -1137,18 +1152,23 @@ void bindIcodeOff(PPROC pProc)
     for (int i = 0; i < pProc->Icode.numIcode; i++)
         if (JmpInst(pIcode[i].ll.opcode)) {
             if (pIcode[i].ll.flg & I) {
-                if (!labelSrch(pIcode, pProc->Icode.numIcode, pIcode[i].ll.immed.op,
+                if (!labelSrch(&pProc->Icode, pIcode[i].ll.immed.op,
                                (int *)&pIcode[i].ll.immed.op))
                     pIcode[i].ll.flg |= NO_LABEL;
             } else if (pIcode[i].ll.flg & SWITCH) {
-                p = pIcode[i].ll.caseTbl.entries;
-                for (j = 0; j < pIcode[i].ll.caseTbl.numEntries; j++, p++)
-                    labelSrch(pIcode, pProc->Icode.numIcode, *p, (int *)p);
+                CASE_TBL *tbl = &icodeCaseTbl(&pProc->Icode, &pIcode[i]);
+
+                p = tbl->entries;
+                for (j = 0; j < tbl->numEntries; j++, p++)
+                    labelSrch(&pProc->Icode, *p, (int *)p);
             }
         }
 }
 
-// Performs idioms analysis, and propagates long operands, if any
+/*
+ Performs idioms analysis, and propagates long operands, if any. The calling conventions found
+ are set by setCallConv().
+*/
 void lowLevelAnalysis(PPROC pProc)
 {
     // Idiom analysis - sets up some flags and creates some HIGH_LEVEL icodes
@@ -1157,3 +1177,32 @@ void lowLevelAnalysis(PPROC pProc)
     // Propagate HIGH_LEVEL idiom information for long operands
     propLong(pProc);
 }
+
+/*
+ Sets the calling conventions found by the analysis of pProc, in the order they were found, and
+ the number of bytes of parameters of the calls of pProc that take their callee's. Procedures are
+ to be passed in the order they were analysed in, after their high-level icodes were generated.
+*/
+void setCallConv(PPROC pProc)
+{
+    for (int i = 0; i < pProc->numCallConv; i++) {
+        CALL_CONV *conv = &pProc->callConv[i];
+
+        // An unknown convention only replaces a different number of bytes
+        if (conv->flg == CALL_UNKNOWN && conv->proc->cbParam == conv->cb)
+            continue;
+
+        conv->proc->cbParam = conv->cb;
+        conv->proc->flg |= conv->flg;
+    }
+
+    free(pProc->callConv);
+    pProc->callConv = NULL;
+    pProc->numCallConv = pProc->allocCallConv = 0;
+
+    PICODE pIcode = pProc->Icode.icode;
+    for (int i = 0; i < pProc->Icode.numIcode; i++, pIcode++)
+        if (pIcode->type == HIGH_LEVEL && icodeHl(pIcode).opcode == CALL &&
+            pIcode->ll.cb == 0)
+            icodeHl(pIcode).oper.call.args->cb = icodeHl(pIcode).oper.call.proc->cbParam;
+}
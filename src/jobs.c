@@ -0,0 +1,149 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/*
+ dcc project worker threads
+ Runs the independent tasks of a stage (usually one per procedure) on option.numJobs threads.
+ Tasks are taken in order by the next free thread; the caller thread takes part. The worker
+ threads are started by the first parallel stage and wait for the next one until stopJobs().
+*/
+
+#include "dcc.h"
+#include <pthread.h>
+#include <stdlib.h>
+
+// Worker pool and the stage it is running
+static struct {
+    pthread_t *threads;        // Worker threads, NULL until the first parallel stage
+    int numThreads;            // # worker threads started
+    pthread_mutex_t lock;      // Guards the fields below
+    pthread_cond_t start;      // Signalled when a stage is posted or the pool is stopped
+    pthread_cond_t done;       // Signalled when the last task of the stage is done
+    unsigned stage;            // # stages posted so far
+    bool stop;                 // Workers are to exit
+    int numTasks;              // # tasks of the stage
+    void (*task)(int, void *); // Runs one task
+    void *arg;                 // Argument passed to task
+    int nextTask;              // Next task to be taken by a thread
+    int numDone;               // # tasks done
+} pool = { .lock = PTHREAD_MUTEX_INITIALIZER, .start = PTHREAD_COND_INITIALIZER,
+           .done = PTHREAD_COND_INITIALIZER };
+
+// Frees the buffers the modules keep per thread
+static void freeThreadState(void)
+{
+    freeLineBuf();
+    freeExpStk();
+    freeIntPool();
+}
+
+// Runs the tasks of the stage not taken by other threads. Called, and returns, with pool.lock held.
+static void runTasks(void)
+{
+    while (pool.nextTask < pool.numTasks) {
+        int i = pool.nextTask++;
+        void (*task)(int, void *) = pool.task;
+        void *arg = pool.arg;
+
+        pthread_mutex_unlock(&pool.lock);
+        task(i, arg);
+        pthread_mutex_lock(&pool.lock);
+
+        if (++pool.numDone == pool.numTasks)
+            pthread_cond_signal(&pool.done);
+    }
+}
+
+// Worker thread. Takes part in each stage posted until the pool is stopped.
+static void *worker(void *arg)
+{
+    unsigned stage = 0; // Last stage taken part in
+
+    pthread_mutex_lock(&pool.lock);
+    for (;;) {
+        while (!pool.stop && pool.stage == stage)
+            pthread_cond_wait(&pool.start, &pool.lock);
+        if (pool.stop)
+            break;
+
+        stage = pool.stage;
+        runTasks();
+    }
+    pthread_mutex_unlock(&pool.lock);
+
+    freeThreadState();
+    return NULL;
+}
+
+// Starts the option.numJobs - 1 worker threads; the caller thread is the last one.
+static void startJobs(void)
+{
+    pool.threads = allocMem((option.numJobs - 1) * sizeof(pthread_t));
+
+    for (int i = 0; i < option.numJobs - 1; i++)
+        if (pthread_create(&pool.threads[pool.numThreads], NULL, worker, NULL) == 0)
+            pool.numThreads++;
+}
+
+/*
+ Runs task(i, arg) for i = 0 .. numTasks - 1, and returns once they are all done. The tasks
+ are run in order on this thread when option.numJobs is at most 1.
+*/
+void parallelFor(int numTasks, void (*task)(int, void *), void *arg)
+{
+    if (option.numJobs <= 1 || numTasks <= 1) {
+        for (int i = 0; i < numTasks; i++)
+            task(i, arg);
+        return;
+    }
+
+    if (!pool.threads)
+        startJobs();
+
+    pthread_mutex_lock(&pool.lock);
+    pool.numTasks = numTasks;
+    pool.task = task;
+    pool.arg = arg;
+    pool.nextTask = pool.numDone = 0;
+    pool.stage++;
+    pthread_cond_broadcast(&pool.start);
+
+    runTasks();
+    while (pool.numDone < pool.numTasks)
+        pthread_cond_wait(&pool.done, &pool.lock);
+    pthread_mutex_unlock(&pool.lock);
+}
+
+// Stops the worker threads, and frees the per thread buffers of the caller thread too.
+void stopJobs(void)
+{
+    if (pool.threads) {
+        pthread_mutex_lock(&pool.lock);
+        pool.stop = true;
+        pthread_cond_broadcast(&pool.start);
+        pthread_mutex_unlock(&pool.lock);
+
+        for (int i = 0; i < pool.numThreads; i++)
+            pthread_join(pool.threads[i], NULL);
+
+        free(pool.threads);
+        pool.threads = NULL;
+        pool.numThreads = 0;
+    }
+
+    freeThreadState();
+}
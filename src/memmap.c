@@ -0,0 +1,161 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/*
+ dcc project memory map module
+ The memory map (prog.map) holds 2 bits (BM_xxx) per image byte, packed in 64-bit words of
+ 32 image bytes each. Range operations work a whole word at a time.
+*/
+
+#include "dcc.h"
+
+#define MAP_BYTES 32                       // Image bytes per map word
+#define MAP_ONES 0x5555555555555555ULL     // Low bit of every 2-bit field
+#define mapPattern(t) ((uint64_t)(t) * MAP_ONES) // Type t replicated in every field
+
+static uint32_t *codeCount; // Number of code bytes before each map word, see indexCode
+
+// Returns the mask of the fields of image bytes [from, to) of a map word, 0 <= from < to <= 32
+static uint64_t fieldMask(uint32_t from, uint32_t to)
+{
+    uint64_t mask = (to - from == MAP_BYTES) ? ~0ULL : (1ULL << ((to - from) << 1)) - 1;
+    return mask << (from << 1);
+}
+
+// Clips the range [start, start + len) to the image. Returns the end of the range
+static uint32_t clipRange(uint32_t start, uint32_t len)
+{
+    if (len > prog.cbImage - start)
+        len = prog.cbImage - start;
+    return start + len;
+}
+
+// Returns the size in bytes of a memory map for an image of cb bytes
+size_t mapSize(size_t cb)
+{
+    return ((cb + MAP_BYTES - 1) / MAP_BYTES) * sizeof(uint64_t);
+}
+
+// setBits - Sets memory bitmap bits for BM_CODE or BM_DATA (additively)
+void setBits(int16_t type, uint32_t start, uint32_t len)
+{
+    if (start >= prog.cbImage || len == 0)
+        return;
+
+    uint32_t end = clipRange(start, len);
+    uint64_t pattern = mapPattern(type);
+
+    for (uint32_t w = start / MAP_BYTES; w * MAP_BYTES < end; w++) {
+        uint32_t from = (w == start / MAP_BYTES) ? start % MAP_BYTES : 0;
+        uint32_t to = ((w + 1) * MAP_BYTES <= end) ? MAP_BYTES : end % MAP_BYTES;
+        prog.map[w] |= pattern & fieldMask(from, to);
+    }
+}
+
+// testBits - Returns true if any byte in [start, start + len) has any of the type bits set
+bool testBits(int16_t type, uint32_t start, uint32_t len)
+{
+    return len != 0 && nextBits(type, start, clipRange(start, len)) < clipRange(start, len);
+}
+
+/*
+ nextBits - Returns the offset of the first byte in [start, end) that has any of the type bits
+ set, or end if there is none. Bytes past the image are never flagged.
+*/
+uint32_t nextBits(int16_t type, uint32_t start, uint32_t end)
+{
+    if (start >= end)
+        return start;
+
+    uint32_t last = (end < prog.cbImage) ? end : prog.cbImage;
+    uint64_t pattern = mapPattern(type);
+
+    for (uint32_t w = start / MAP_BYTES; w * MAP_BYTES < last; w++) {
+        uint32_t from = (w == start / MAP_BYTES) ? start % MAP_BYTES : 0;
+        uint32_t to = ((w + 1) * MAP_BYTES <= last) ? MAP_BYTES : last % MAP_BYTES;
+        uint64_t m = prog.map[w] & pattern & fieldMask(from, to);
+
+        if (m)
+            return w * MAP_BYTES + (__builtin_ctzll(m) >> 1);
+    }
+    return end;
+}
+
+// Returns the number of fields of m that are not zero
+static uint32_t countFields(uint64_t m)
+{
+    return __builtin_popcountll((m | (m >> 1)) & MAP_ONES);
+}
+
+// Returns the number of code bytes before image offset off. Needs indexCode
+static uint32_t codeBefore(uint32_t off)
+{
+    uint32_t n = codeCount[off / MAP_BYTES];
+
+    if (off % MAP_BYTES)
+        n += countFields(prog.map[off / MAP_BYTES] & mapPattern(BM_CODE) & fieldMask(0, off % MAP_BYTES));
+    return n;
+}
+
+/*
+ indexCode - Builds a prefix count of the code bytes in the memory map, so that codeBits can
+ tell whether a range holds code in constant time. It must be rebuilt whenever BM_CODE bits
+ are set, i.e. after parsing.
+*/
+void indexCode(void)
+{
+    uint32_t numWords = (uint32_t)(mapSize(prog.cbImage) / sizeof(uint64_t));
+    uint64_t pattern = mapPattern(BM_CODE);
+
+    codeCount = allocVar(codeCount, (numWords + 1) * sizeof(uint32_t));
+    codeCount[0] = 0;
+    for (uint32_t w = 0; w < numWords; w++)
+        codeCount[w + 1] = codeCount[w] + countFields(prog.map[w] & pattern);
+}
+
+// codeBits - Returns true if any byte in [start, start + len) is code. Needs indexCode
+bool codeBits(uint32_t start, uint32_t len)
+{
+    if (start >= prog.cbImage || len == 0)
+        return false;
+
+    uint32_t end = clipRange(start, len);
+
+    return codeBefore(end) != codeBefore(start);
+}
+
+/*
+ nextChange - Returns the offset of the first byte at or after start whose map type differs
+ from that of start, or prog.cbImage if the rest of the image has the same type.
+*/
+uint32_t nextChange(uint32_t start)
+{
+    if (start >= prog.cbImage)
+        return prog.cbImage;
+
+    uint64_t pattern = mapPattern(MAPTYPE(start));
+
+    for (uint32_t w = start / MAP_BYTES; w * MAP_BYTES < prog.cbImage; w++) {
+        uint32_t from = (w == start / MAP_BYTES) ? start % MAP_BYTES : 0;
+        uint32_t to = ((w + 1) * MAP_BYTES <= prog.cbImage) ? MAP_BYTES : prog.cbImage % MAP_BYTES;
+        uint64_t m = (prog.map[w] ^ pattern) & fieldMask(from, to);
+
+        if (m)
+            return w * MAP_BYTES + (__builtin_ctzll(m) >> 1);
+    }
+    return prog.cbImage;
+}
@@ -36,11 +36,14 @@
                          2. When a value is moved into the variable for the first time. */
 #define USEVAL 0x1100 // Use and Val
 
-static void FollowCtrl(PPROC pProc, PCALL_GRAPH pcallGraph, PSTATE pstate);
-static bool process_JMP(PICODE pIcode, PPROC pProc, PSTATE pstate, PCALL_GRAPH pcallGraph);
-static bool process_CALL(PICODE pIcode, PPROC pProc, PCALL_GRAPH pcallGraph, PSTATE pstate);
+#define SYMTAB_INIT 32 // Initial # symbols allocated in the global symbol table
+#define INST_BYTES 3     // Rough average length of an 8086 instruction
+#define ICODE_HINT_MAX 256 // Largest icode array presized for a procedure
+
+static void FollowCtrl(PPROC pProc, PSTATE pstate);
+static bool process_JMP(PICODE pIcode, PPROC pProc, PSTATE pstate);
+static bool process_CALL(PICODE pIcode, PPROC pProc, PSTATE pstate);
 static void process_operands(PICODE pIcode, PPROC pProc, PSTATE pstate, int ix);
-static void setBits(int16_t type, uint32_t start, uint32_t len);
 static PSYM updateGlobSym(uint32_t operand, int size, uint16_t duFlag);
 static void process_MOV(PICODE pIcode, PSTATE pstate);
 static PSYM lookupAddr(PMEM pm, PSTATE pstate, int size, uint16_t duFlag);
@@ -66,53 +69,90 @@ void parse(PCALL_GRAPH *pcallGraph)
     checkStartup(&state);
 
     // Make a struct for the initial procedure
-    pProcList = memset(allocStruc(PROC), 0, sizeof(PROC));
-
     if (prog.offMain != -1) {
         // We know where main() is. Start the flow of control from there
-        pProcList->procEntry = prog.offMain;
+        newProc(prog.offMain);
         /* In medium and large models, the segment of main may (will?) not be
            the same as the initial CS segment (of the startup code) */
         setState(&state, rCS, prog.segMain);
         strcpy(pProcList->name, "main");
         state.IP = prog.offMain;
     } else // Create initial procedure at program start address
-        pProcList->procEntry = state.IP;
+        newProc(state.IP);
 
 
     // The state info is for the first procedure
     memcpy(&(pProcList->state), &state, sizeof(STATE));
-    pLastProc = pProcList;
 
     // Set up call graph initial node
-    *pcallGraph = memset(allocStruc(CALL_GRAPH), 0, sizeof(CALL_GRAPH));
-    (*pcallGraph)->proc = pProcList;
+    *pcallGraph = newCallGraph(pProcList, NULL);
 
     /* This proc needs to be called to set things up for LibCheck(),
        which checks a proc to see if it is a know C (etc) library */
     bool err = SetupLibCheck();
 
+    // Decode the image ahead, so that following the flow of control only looks instructions up
+    if (option.predecode)
+        predecode();
+
     // Recursively build entire procedure list
-    FollowCtrl(pProcList, *pcallGraph, &state);
+    FollowCtrl(pProcList, &state);
+    freePredecode();
 
     // This proc needs to be called to clean things up from SetupLibCheck()
     if (err)
         CleanupLibCheck();
 }
 
+// Enters symbol idx of the global symbol table in its label index
+static void insertGlobSymIdx(int idx)
+{
+    uint32_t mask = symtab.idxAlloc - 1;
+    uint32_t h;
+
+    for (h = HASH(symtab.sym[idx].label, mask); symtab.idx[h] != -1; h = (h + 1) & mask);
+    symtab.idx[h] = idx;
+}
+
+// Doubles the label index of the global symbol table and rehashes the symbols into it
+static void growGlobSymIdx(void)
+{
+    symtab.idxAlloc = symtab.idxAlloc ? symtab.idxAlloc * 2 : 2 * SYMTAB_INIT;
+    free(symtab.idx);
+    symtab.idx = allocMem(symtab.idxAlloc * sizeof(int));
+    memset(symtab.idx, -1, symtab.idxAlloc * sizeof(int));
+
+    for (int i = 0; i < symtab.csym; i++)
+        insertGlobSymIdx(i);
+}
+
+// Returns the index of the global symbol at the given 20-bit label, or -1 if there is none
+int findGlobSym(uint32_t label)
+{
+    if (!symtab.idxAlloc)
+        return -1;
+
+    uint32_t mask = symtab.idxAlloc - 1;
+
+    for (uint32_t h = HASH(label, mask); symtab.idx[h] != -1; h = (h + 1) & mask)
+        if (symtab.sym[symtab.idx[h]].label == label)
+            return symtab.idx[h];
+    return -1;
+}
+
 /*
  Updates the type of the symbol in the symbol table.
  The size is updated if necessary (0 means no update necessary).
 */
 static void updateSymType(uint32_t symbol, hlType symType, int size)
 {
-    for (int i = 0; i < symtab.csym; i++)
-        if (symtab.sym[i].label == symbol) {
-            symtab.sym[i].type = symType;
-            if (size != 0)
-                symtab.sym[i].size = size;
-            break;
-        }
+    int i = findGlobSym(symbol);
+
+    if (i != -1) {
+        symtab.sym[i].type = symType;
+        if (size != 0)
+            symtab.sym[i].size = size;
+    }
 }
 
 // Returns the size of the string pointed by sym and delimited by delim. Size includes delimiter.
@@ -125,11 +165,22 @@ size_t strSize(uint8_t *sym, char delim)
     return (i + 1);
 }
 
+/*
+ Estimates the number of icodes of a procedure about to be parsed, from the gap between its
+ entry point and the next byte already known to be code.
+*/
+static int icodeHint(uint32_t procEntry)
+{
+    uint32_t gap = nextBits(BM_CODE, procEntry, prog.cbImage) - procEntry;
+
+    return (gap / INST_BYTES < ICODE_HINT_MAX) ? (int)(gap / INST_BYTES) : ICODE_HINT_MAX;
+}
+
 /*
  FollowCtrl - Given an initial procedure, state information and symbol table builds a list
  of procedures reachable from the initial procedure using a depth first search.
 */
-static void FollowCtrl(PPROC pProc, PCALL_GRAPH pcallGraph, PSTATE pstate)
+static void FollowCtrl(PPROC pProc, PSTATE pstate)
 {
     ICODE Icode, *pIcode; // This gets copied to pProc->Icode[] later
     ICODE eIcode;         // extra icodes for iDIV, iIDIV, iXCHG
@@ -138,6 +189,11 @@ static void FollowCtrl(PPROC pProc, PCALL_GRAPH pcallGraph, PSTATE pstate)
     int err, lab;
     bool done = false;
 
+    /* Presize the icode array when the procedure starts being parsed, so that library
+       procedures, which are never parsed, get none */
+    if (pProc->Icode.alloc == 0)
+        reserveIcode(&pProc->Icode, icodeHint(pstate->IP));
+
     while (!done && !(err = scan(pstate->IP, &Icode))) {
         pstate->IP += Icode.ll.numBytes;
         setBits(BM_CODE, Icode.ll.label, Icode.ll.numBytes);
@@ -148,7 +204,7 @@ static void FollowCtrl(PPROC pProc, PCALL_GRAPH pcallGraph, PSTATE pstate)
         pProc->flg |= (Icode.ll.flg & (NOT_HLL | FLOAT_OP));
 
         // Check if this instruction has already been parsed
-        if (labelSrch(pProc->Icode.icode, pProc->Icode.numIcode, Icode.ll.label, &lab)) { // Synthetic jump
+        if (labelSrch(&pProc->Icode, Icode.ll.label, &lab)) { // Synthetic jump
             Icode.type = LOW_LEVEL;
             Icode.ll.opcode = iJMP;
             Icode.ll.flg = I | SYNTHETIC | NO_OPS;
@@ -271,7 +327,7 @@ static void FollowCtrl(PPROC pProc, PCALL_GRAPH pcallGraph, PSTATE pstate)
             memcpy(&StCopy, pstate, sizeof(STATE));
 
             // Straight line code
-            FollowCtrl(pProc, pcallGraph, &StCopy);
+            FollowCtrl(pProc, &StCopy);
 
             if (fBranch) // Do branching code
                 pstate->JCond.regi = prev->ll.dst.regi;
@@ -281,13 +337,13 @@ static void FollowCtrl(PPROC pProc, PCALL_GRAPH pcallGraph, PSTATE pstate)
         // Jumps
         case iJMP:
         case iJMPF: // Returns TRUE if we've run into a loop
-            done = process_JMP(pIcode, pProc, pstate, pcallGraph);
+            done = process_JMP(pIcode, pProc, pstate);
             break;
 
         // Calls
         case iCALL:
         case iCALLF:
-            done = process_CALL(pIcode, pProc, pcallGraph, pstate);
+            done = process_CALL(pIcode, pProc, pstate);
             break;
 
         // Returns
@@ -378,7 +434,7 @@ static void FollowCtrl(PPROC pProc, PCALL_GRAPH pcallGraph, PSTATE pstate)
 }
 
 // process_JMP - Handles JMPs, returns TRUE if we should end recursion
-static bool process_JMP(PICODE pIcode, PPROC pProc, PSTATE pstate, PCALL_GRAPH pcallGraph)
+static bool process_JMP(PICODE pIcode, PPROC pProc, PSTATE pstate)
 {
     static uint8_t i2r[4] = { rSI, rDI, rBP, rBX };
     ICODE Icode;
@@ -392,7 +448,7 @@ static bool process_JMP(PICODE pIcode, PPROC pProc, PSTATE pstate, PCALL_GRAPH p
         i = pstate->IP = pIcode->ll.immed.op;
 
         // Return TRUE if jump target is already parsed
-        return labelSrch(pProc->Icode.icode, pProc->Icode.numIcode, i, &tmp);
+        return labelSrch(&pProc->Icode, i, &tmp);
     }
 
     /* We've got an indirect JMP - look for switch() stmt.
@@ -419,9 +475,7 @@ static bool process_JMP(PICODE pIcode, PPROC pProc, PSTATE pstate, PCALL_GRAPH p
             endTable = prog.cbImage;
 
         // Search for first byte flagged after start of table
-        for (i = offTable; i <= endTable; i++)
-            if (BITMAP(i, BM_CODE | BM_DATA))
-                break;
+        i = nextBits(BM_CODE | BM_DATA, offTable, endTable + 1);
         endTable = i & ~1; // Max. possible table size
 
         /* Now do some heuristic pruning. Look for ptrs. into the table
@@ -452,18 +506,18 @@ static bool process_JMP(PICODE pIcode, PPROC pProc, PSTATE pstate, PCALL_GRAPH p
             setBits(BM_DATA, offTable, endTable - offTable);
 
             pIcode->ll.flg |= SWITCH;
-            pIcode->ll.caseTbl.numEntries = (endTable - offTable) / 2;
-            uint32_t *psw = allocMem(pIcode->ll.caseTbl.numEntries * sizeof(uint32_t));
-            pIcode->ll.caseTbl.entries = psw;
+            pIcode->ll.caseIdx = newCaseTbl(&pProc->Icode, (endTable - offTable) / 2);
+            // The case tables may move while following the cases, but not their entries
+            uint32_t *psw = icodeCaseTbl(&pProc->Icode, pIcode).entries;
 
             for (i = offTable, k = 0; i < endTable; i += 2) {
                 memcpy(&StCopy, pstate, sizeof(STATE));
                 StCopy.IP = cs + LH(&prog.Image[i]);
                 ip = pProc->Icode.numIcode;
 
-                FollowCtrl(pProc, pcallGraph, &StCopy);
+                FollowCtrl(pProc, &StCopy);
 
-                pProc->Icode.icode[ip].ll.caseTbl.numEntries = k++;
+                pProc->Icode.icode[ip].ll.caseIdx = k++;
                 pProc->Icode.icode[ip].ll.flg |= CASE;
                 *psw++ = pProc->Icode.icode[ip].ll.label;
             }
@@ -487,9 +541,9 @@ static bool process_JMP(PICODE pIcode, PPROC pProc, PSTATE pstate, PCALL_GRAPH p
        call anyway and it's to be assumed that if an assembler program contains a CALL
        that the programmer expected it to come back - otherwise surely a JMP would have been used.
 */
-static bool process_CALL(PICODE pIcode, PPROC pProc, PCALL_GRAPH pcallGraph, PSTATE pstate)
+static bool process_CALL(PICODE pIcode, PPROC pProc, PSTATE pstate)
 {
-    PPROC p, pPrev;
+    PPROC p;
     int ip = pProc->Icode.numIcode - 1;
     STATE localState; // Local copy of the machine state
     uint32_t off;
@@ -513,24 +567,19 @@ static bool process_CALL(PICODE pIcode, PPROC pProc, PCALL_GRAPH pcallGraph, PST
 
     // Process CALL. Function address is located in pIcode->ll.immed.op
     if (pIcode->ll.flg & I) {
-        // Search procedure list for one with appropriate entry point
-        for (p = pProcList; p && p->procEntry != pIcode->ll.immed.op; p = p->next)
-            pPrev = p;
+        // Search procedure index for one with appropriate entry point
+        p = findProc(pIcode->ll.immed.op);
 
         // Create a new procedure node and save copy of the state
         if (!p) {
-            p = memset(allocStruc(PROC), 0, sizeof(PROC));
-            pPrev->next = p;
-            p->prev = pPrev;
-            p->procEntry = pIcode->ll.immed.op;
-            pLastProc = p; // Pointer to last node in the list
+            p = newProc(pIcode->ll.immed.op);
 
             LibCheck(p);
 
             if (p->flg & PROC_ISLIB) {
                 // A library function. No need to do any more to it
-                insertCallGraph(pcallGraph, pProc, p);
-                pProc->Icode.icode[ip].ll.immed.proc.proc = p;
+                insertCallGraph(pProc, p);
+                pProc->Icode.icode[ip].ll.immed.proc = p;
                 return false;
             }
 
@@ -554,10 +603,10 @@ static bool process_CALL(PICODE pIcode, PPROC pProc, PCALL_GRAPH pcallGraph, PST
             memcpy(&(p->state), pstate, sizeof(STATE));
 
             // Insert new procedure in call graph
-            insertCallGraph(pcallGraph, pProc, p);
+            insertCallGraph(pProc, p);
 
             // Process new procedure
-            FollowCtrl(p, pcallGraph, pstate);
+            FollowCtrl(p, pstate);
 
             // Restore segment registers & IP from localState
             pstate->IP = localState.IP;
@@ -567,9 +616,9 @@ static bool process_CALL(PICODE pIcode, PPROC pProc, PCALL_GRAPH pcallGraph, PST
             setState(pstate, rSS, localState.r[rSS]);
 
         } else
-            insertCallGraph(pcallGraph, pProc, p);
+            insertCallGraph(pProc, p);
 
-        pProc->Icode.icode[ip].ll.immed.proc.proc = p; // ^ target proc
+        pProc->Icode.icode[ip].ll.immed.proc = p; // ^ target proc
 
         return false;
     }
@@ -603,17 +652,20 @@ static void process_MOV(PICODE pIcode, PSTATE pstate)
             if (pIcode->ll.flg & I) {  // immediate
                 prog.Image[psym->label] = (uint8_t)pIcode->ll.immed.op;
                 prog.Image[psym->label + 1] = (uint8_t)(pIcode->ll.immed.op >> 8);
+                invalidatePredecode(psym->label, 2);
                 psym->duVal |= VAL;
             } else if (srcReg == 0) { // direct mem offset
                 psym2 = lookupAddr(&pIcode->ll.src, pstate, 2, USE);
                 if (psym2 && ((psym->flg & SEG_IMMED) || (psym->duVal & VAL))) {
                     prog.Image[psym->label] = (uint8_t)prog.Image[psym2->label];
                     prog.Image[psym->label + 1] = (uint8_t)(prog.Image[psym2->label + 1] >> 8);
+                    invalidatePredecode(psym->label, 2);
                     psym->duVal |= VAL;
                 }
             } else if (srcReg < INDEXBASE && pstate->f[srcReg]) { // reg
                 prog.Image[psym->label] = (uint8_t)pstate->r[srcReg];
                 prog.Image[psym->label + 1] = (uint8_t)(pstate->r[srcReg] >> 8);
+                invalidatePredecode(psym->label, 2);
                 psym->duVal |= VAL;
             }
         }
@@ -636,20 +688,16 @@ static hlType cbType[] = {
 */
 static PSYM updateGlobSym(uint32_t operand, int size, uint16_t duFlag)
 {
-    int i;
-
     // Check for symbol in symbol table
-    for (i = 0; i < symtab.csym; i++)
-        if (symtab.sym[i].label == operand) {
-            if (symtab.sym[i].size < size)
-                symtab.sym[i].size = size;
-            break;
-        }
+    int i = findGlobSym(operand);
 
-    // New symbol, not in symbol table
-    if (i == symtab.csym) {
+    if (i != -1) {
+        if (symtab.sym[i].size < size)
+            symtab.sym[i].size = size;
+    } else { // New symbol, not in symbol table
+        i = symtab.csym;
         if (++symtab.csym > symtab.alloc) {
-            symtab.alloc += 5;
+            symtab.alloc = symtab.alloc ? symtab.alloc * 2 : SYMTAB_INIT;
             symtab.sym = allocVar(symtab.sym, symtab.alloc * sizeof(SYM));
         }
 
@@ -663,6 +711,12 @@ static PSYM updateGlobSym(uint32_t operand, int size, uint16_t duFlag)
             symtab.sym[i].duVal = USEVAL;
         else
             symtab.sym[i].duVal = duFlag;
+
+        // Keep the label index at most half full
+        if (symtab.csym * 2 > symtab.idxAlloc)
+            growGlobSymIdx(); // Also enters the new symbol
+        else
+            insertGlobSymIdx(i);
     }
 
     return (&symtab.sym[i]);
@@ -685,10 +739,8 @@ static void updateFrameOff(PSTKFRAME ps, int16_t off, int size, uint16_t duFlag)
 
     // New symbol, not in table
     if (i == ps->csym) {
-        if (++ps->csym > ps->alloc) {
-            ps->alloc += 5;
-            ps->sym = allocVar(ps->sym, ps->alloc * sizeof(STKSYM));
-        }
+        if (++ps->csym > ps->alloc)
+            growStkFrame(ps, ps->alloc + 5);
         sprintf(ps->sym[i].name, "arg%d", i);
         ps->sym[i].off = off;
         ps->sym[i].regOff = 0;
@@ -736,11 +788,8 @@ static PSYM lookupAddr(PMEM pm, PSTATE pstate, int size, uint16_t duFlag)
             if (symtab.csym > i) {
                 if (size == 4)
                     operand += 2; // High word
-                for (i = 0; i < prog.cReloc; i++)
-                    if (prog.relocTable[i] == operand) {
-                        psym->flg = SEG_IMMED;
-                        break;
-                    }
+                if (operand < prog.cbImage && RELOCMAP(operand))
+                    psym->flg = SEG_IMMED;
             }
 
             // Check for out of bounds
@@ -792,33 +841,6 @@ void setState(PSTATE pstate, uint16_t reg, int16_t value)
     }
 }
 
-/*
- labelSrchRepl - Searches Icode for instruction with label = target,
- and replaces *pIndex with an icode index
-*/
-bool labelSrch(PICODE pIcode, int numIp, uint32_t target, int *pIndex)
-{
-    for (int i = 0; i < numIp; i++) {
-        if (pIcode[i].ll.label == target) {
-            *pIndex = i;
-            return true;
-        }
-    }
-    return false;
-}
-
-// setBits - Sets memory bitmap bits for BM_CODE or BM_DATA (additively)
-static void setBits(int16_t type, uint32_t start, uint32_t len)
-{
-    if (start < prog.cbImage) {
-        if (start + len > prog.cbImage)
-            len = prog.cbImage - start;
-
-        for (uint32_t i = start + len - 1; i >= start; i--)
-            prog.map[i >> 2] |= type << ((i & 3) << 1);
-    }
-}
-
 // DU bit definitions for each reg value - including index registers
 uint32_t duReg[] = {
     0x00,
@@ -866,7 +888,7 @@ static void use(opLoc d, PICODE pIcode, PPROC pProc, PSTATE pstate, int size, in
         else if ((psym = lookupAddr(pm, pstate, size, USE))) {
             setBits(BM_DATA, psym->label, (uint32_t)size);
             pIcode->ll.flg |= SYM_USE;
-            pIcode->ll.caseTbl.numEntries = psym - symtab.sym;
+            pIcode->ll.caseIdx = psym - symtab.sym;
         }
     }
     // Use of register
@@ -904,13 +926,13 @@ static void def(opLoc d, PICODE pIcode, PPROC pProc, PSTATE pstate, int size, in
         else if ((psym = lookupAddr(pm, pstate, size, DEF))) {
             setBits(BM_DATA, psym->label, (uint32_t)size);
             pIcode->ll.flg |= SYM_DEF;
-            pIcode->ll.caseTbl.numEntries = psym - symtab.sym;
+            pIcode->ll.caseIdx = psym - symtab.sym;
         }
     }
     // Definition of register
     else if ((d == DST) || ((d == SRC) && (pIcode->ll.flg & I) != I)) {
         pIcode->du.def |= duReg[pm->regi];
-        pIcode->du1.numRegsDef++;
+        pIcode->numRegsDef++;
     }
 }
 
@@ -926,7 +948,7 @@ static void use_def(opLoc d, PICODE pIcode, PPROC pProc, PSTATE pstate, int cb,
 
     if (pm->regi < INDEXBASE) { // register
         pIcode->du.def |= duReg[pm->regi];
-        pIcode->du1.numRegsDef++;
+        pIcode->numRegsDef++;
     }
 }
 
@@ -998,10 +1020,10 @@ static void process_operands(PICODE pIcode, PPROC pProc, PSTATE pstate, int ix)
             use(DST, pIcode, pProc, pstate, cb, ix);
             if (cb == 1) {
                 pIcode->du.def |= duReg[rAX];
-                pIcode->du1.numRegsDef++;
+                pIcode->numRegsDef++;
             } else {
                 pIcode->du.def |= (duReg[rAX] | duReg[rDX]);
-                pIcode->du1.numRegsDef += 2;
+                pIcode->numRegsDef += 2;
             }
         } else
             def(DST, pIcode, pProc, pstate, cb, ix);
@@ -1011,11 +1033,11 @@ static void process_operands(PICODE pIcode, PPROC pProc, PSTATE pstate, int ix)
         cb = (pIcode->ll.flg & SRC_B) ? 1 : 2;
         if (cb == 1) { // byte
             pIcode->du.def |= duReg[rAX];
-            pIcode->du1.numRegsDef++;
+            pIcode->numRegsDef++;
             pIcode->du.use |= duReg[rAL];
         } else { // word
             pIcode->du.def |= (duReg[rDX] | duReg[rAX]);
-            pIcode->du1.numRegsDef += 2;
+            pIcode->numRegsDef += 2;
             pIcode->du.use |= duReg[rAX];
         }
         break;
@@ -1040,7 +1062,7 @@ static void process_operands(PICODE pIcode, PPROC pProc, PSTATE pstate, int ix)
     case iLDS:
     case iLES:
         pIcode->du.def |= duReg[(pIcode->ll.opcode == iLDS) ? rDS : rES];
-        pIcode->du1.numRegsDef++;
+        pIcode->numRegsDef++;
         cb = 4;
     case iMOV:
         use(SRC, pIcode, pProc, pstate, cb, ix);
@@ -1068,7 +1090,7 @@ static void process_operands(PICODE pIcode, PPROC pProc, PSTATE pstate, int ix)
     case iLOOPE:
     case iLOOPNE:
         pIcode->du.def |= duReg[rCX];
-        pIcode->du1.numRegsDef++;
+        pIcode->numRegsDef++;
     case iJCXZ:
         pIcode->du.use |= duReg[rCX];
         break;
@@ -1077,12 +1099,12 @@ static void process_operands(PICODE pIcode, PPROC pProc, PSTATE pstate, int ix)
     case iREPE_CMPS:
     case iREP_MOVS:
         pIcode->du.def |= duReg[rCX];
-        pIcode->du1.numRegsDef++;
+        pIcode->numRegsDef++;
         pIcode->du.use |= duReg[rCX];
     case iCMPS:
     case iMOVS:
         pIcode->du.def |= duReg[rSI] | duReg[rDI];
-        pIcode->du1.numRegsDef += 2;
+        pIcode->numRegsDef += 2;
         pIcode->du.use |= duReg[rSI] | duReg[rDI] | duReg[rES] | duReg[sseg];
         break;
 
@@ -1091,13 +1113,13 @@ static void process_operands(PICODE pIcode, PPROC pProc, PSTATE pstate, int ix)
     case iREP_STOS:
     case iREP_INS:
         pIcode->du.def |= duReg[rCX];
-        pIcode->du1.numRegsDef++;
+        pIcode->numRegsDef++;
         pIcode->du.use |= duReg[rCX];
     case iSCAS:
     case iSTOS:
     case iINS:
         pIcode->du.def |= duReg[rDI];
-        pIcode->du1.numRegsDef++;
+        pIcode->numRegsDef++;
         if (pIcode->ll.opcode == iREP_INS || pIcode->ll.opcode == iINS) {
             pIcode->du.use |= duReg[rDI] | duReg[rES] | duReg[rDX];
         } else {
@@ -1107,21 +1129,21 @@ static void process_operands(PICODE pIcode, PPROC pProc, PSTATE pstate, int ix)
 
     case iREP_LODS:
         pIcode->du.def |= duReg[rCX];
-        pIcode->du1.numRegsDef++;
+        pIcode->numRegsDef++;
         pIcode->du.use |= duReg[rCX];
     case iLODS:
         pIcode->du.def |= duReg[rSI] | duReg[(cb == 2) ? rAX : rAL];
-        pIcode->du1.numRegsDef += 2;
+        pIcode->numRegsDef += 2;
         pIcode->du.use |= duReg[rSI] | duReg[sseg];
         break;
 
     case iREP_OUTS:
         pIcode->du.def |= duReg[rCX];
-        pIcode->du1.numRegsDef++;
+        pIcode->numRegsDef++;
         pIcode->du.use |= duReg[rCX];
     case iOUTS:
         pIcode->du.def |= duReg[rSI];
-        pIcode->du1.numRegsDef++;
+        pIcode->numRegsDef++;
         pIcode->du.use |= duReg[rSI] | duReg[rDX] | duReg[sseg];
         break;
 
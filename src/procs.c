@@ -20,13 +20,34 @@
 // Purpose: Functions to support Call graphs and procedures
 
 #include "dcc.h"
+#include <stdlib.h>
 #include <string.h>
 
 #define indSize 61 // size of indentation buffer; max 20
+#define PROC_IDX_INIT 64 // Initial # slots in the procedure index
+#define ARC_IDX_INIT 64  // Initial # slots in the call graph arc index
+
+// Hash key of a (caller, callee) arc
+#define arcKey(caller, callee) ((caller)->procEntry * 0x9E3779B1u + (callee)->procEntry)
 
 // Static indentation buffer
 static char indentBuf[indSize] = "                                                            ";
 
+// Procedure index: procEntry => PPROC, kept alongside pProcList
+static PPROC *procIdx;    // Hashed procedures, NULL if empty slot
+static int procIdxAlloc;  // # slots in procIdx (power of 2)
+static int numProcIdx;    // # procedures in procIdx
+
+// Call graph arc index, to find duplicate arcs without scanning the caller's out edges
+typedef struct {
+    PCALL_GRAPH caller; // Node of the calling procedure, NULL if empty slot
+    PPROC callee;       // Invoked procedure
+} ARC;
+
+static ARC *arcIdx;      // Hashed arcs
+static int arcIdxAlloc;  // # slots in arcIdx (power of 2)
+static int numArcIdx;    // # arcs in arcIdx
+
 
 // Indentation according to the depth of the statement
 static char *indent(int indLevel)
@@ -35,57 +56,151 @@ static char *indent(int indLevel)
 }
 
 
-// Inserts an outEdge at the current callGraph pointer if the newProc does not exist.
+// Enters the procedure in the procedure index
+static void insertProcIdx(PPROC pProc)
+{
+    uint32_t mask = procIdxAlloc - 1;
+    uint32_t h;
+
+    for (h = HASH(pProc->procEntry, mask); procIdx[h]; h = (h + 1) & mask);
+    procIdx[h] = pProc;
+}
+
+// Doubles the procedure index (keeping it at most half full) and rehashes the procedure list
+static void growProcIdx(void)
+{
+    procIdxAlloc = procIdxAlloc ? procIdxAlloc * 2 : PROC_IDX_INIT;
+    free(procIdx);
+    procIdx = memset(allocMem(procIdxAlloc * sizeof(PPROC)), 0, procIdxAlloc * sizeof(PPROC));
+
+    for (PPROC p = pProcList; p; p = p->next)
+        insertProcIdx(p);
+}
+
+/*
+ Creates a procedure with the given entry point, appends it to the procedure list
+ (pProcList, pLastProc) and enters it in the procedure index.
+*/
+PPROC newProc(uint32_t procEntry)
+{
+    PPROC p = memset(allocStruc(PROC), 0, sizeof(PROC));
+    p->procEntry = procEntry;
+
+    if (pLastProc) {
+        pLastProc->next = p;
+        p->prev = pLastProc;
+    } else
+        pProcList = p;
+    pLastProc = p; // Pointer to last node in the list
+
+    if (++numProcIdx * 2 > procIdxAlloc)
+        growProcIdx(); // Also enters the new procedure
+    else
+        insertProcIdx(p);
+
+    return p;
+}
+
+// Returns the procedure with the given entry point, or NULL if there is none
+PPROC findProc(uint32_t procEntry)
+{
+    if (!procIdxAlloc)
+        return NULL;
+
+    uint32_t mask = procIdxAlloc - 1;
+
+    for (uint32_t h = HASH(procEntry, mask); procIdx[h]; h = (h + 1) & mask)
+        if (procIdx[h]->procEntry == procEntry)
+            return procIdx[h];
+    return NULL;
+}
+
+
+// Creates the call graph node of a procedure, first invoked from the node parent
+PCALL_GRAPH newCallGraph(PPROC proc, PCALL_GRAPH parent)
+{
+    PCALL_GRAPH pcg = memset(allocStruc(CALL_GRAPH), 0, sizeof(CALL_GRAPH));
+    pcg->proc = proc;
+    pcg->parent = parent;
+    proc->callNode = pcg;
+    return pcg;
+}
+
+// Enters the arc in the arc index, returns FALSE if it was there already
+static bool insertArcIdx(PCALL_GRAPH caller, PPROC callee)
+{
+    uint32_t mask = arcIdxAlloc - 1;
+    uint32_t h;
+
+    for (h = HASH(arcKey(caller->proc, callee), mask); arcIdx[h].caller; h = (h + 1) & mask)
+        if (arcIdx[h].caller == caller && arcIdx[h].callee == callee)
+            return false;
+    arcIdx[h].caller = caller;
+    arcIdx[h].callee = callee;
+    return true;
+}
+
+// Doubles the arc index (keeping it at most half full) and rehashes the arcs into it
+static void growArcIdx(void)
+{
+    ARC *old = arcIdx;
+    int oldAlloc = arcIdxAlloc;
+
+    arcIdxAlloc = arcIdxAlloc ? arcIdxAlloc * 2 : ARC_IDX_INIT;
+    arcIdx = memset(allocMem(arcIdxAlloc * sizeof(ARC)), 0, arcIdxAlloc * sizeof(ARC));
+
+    for (int i = 0; i < oldAlloc; i++)
+        if (old[i].caller)
+            insertArcIdx(old[i].caller, old[i].callee);
+    free(old);
+}
+
+// Inserts an outEdge at the caller's call graph node if the newProc is not invoked there yet.
 static void insertArc(PCALL_GRAPH pcallGraph, PPROC newProc)
 {
-    CALL_GRAPH *pcg;
+    if ((numArcIdx + 1) * 2 > arcIdxAlloc)
+        growArcIdx();
 
     // Check if procedure already exists
-    for (int i = 0; i < pcallGraph->numOutEdges; i++)
-        if (pcallGraph->outEdges[i]->proc == newProc)
-            return;
+    if (!insertArcIdx(pcallGraph, newProc))
+        return;
+    numArcIdx++;
 
     // Check if need to allocate more space
     if (pcallGraph->numOutEdges == pcallGraph->numAlloc) {
-        pcallGraph->numAlloc += NUM_PROCS_DELTA;
+        pcallGraph->numAlloc = pcallGraph->numAlloc ? pcallGraph->numAlloc * 2 : NUM_PROCS_INIT;
         pcallGraph->outEdges =
             allocVar(pcallGraph->outEdges, pcallGraph->numAlloc * sizeof(PCALL_GRAPH));
     }
 
-    // Include new arc
-    pcg = allocStruc(CALL_GRAPH);
-    memset(pcg, 0, sizeof(CALL_GRAPH));
-    pcg->proc = newProc;
-    pcallGraph->outEdges[pcallGraph->numOutEdges] = pcg;
+    // Include new arc. The first caller of a procedure owns its node in the call graph tree
+    if (!newProc->callNode)
+        newCallGraph(newProc, pcallGraph);
+    pcallGraph->outEdges[pcallGraph->numOutEdges] = newProc->callNode;
     pcallGraph->numOutEdges++;
 }
 
 
-// Inserts a (caller, callee) arc in the call graph tree.
-bool insertCallGraph(PCALL_GRAPH pcallGraph, PPROC caller, PPROC callee)
+// Inserts a (caller, callee) arc in the call graph. The caller must be in the graph already.
+void insertCallGraph(PPROC caller, PPROC callee)
 {
-    if (pcallGraph->proc == caller) {
-        insertArc(pcallGraph, callee);
-        return true;
-    } else {
-        for (int i = 0; i < pcallGraph->numOutEdges; i++)
-            if (insertCallGraph(pcallGraph->outEdges[i], caller, callee))
-                return true;
-        return false;
-    }
+    insertArc(caller->callNode, callee);
 }
 
 
 /*
  Displays the current node of the call graph, and invokes recursively on the nodes
- the procedure invokes.
+ the procedure invokes. Procedures are expanded only under their first caller.
 */
 static void writeNodeCallGraph(PCALL_GRAPH pcallGraph, int indIdx)
 {
     printf("%s%s\n", indent(indIdx), pcallGraph->proc->name);
 
     for (int i = 0; i < pcallGraph->numOutEdges; i++)
-        writeNodeCallGraph(pcallGraph->outEdges[i], indIdx + 1);
+        if (pcallGraph->outEdges[i]->parent == pcallGraph)
+            writeNodeCallGraph(pcallGraph->outEdges[i], indIdx + 1);
+        else
+            printf("%s%s\n", indent(indIdx + 1), pcallGraph->outEdges[i]->proc->name);
 }
 
 
@@ -100,6 +215,20 @@ void writeCallGraph(PCALL_GRAPH pcallGraph)
 
 // Routines to support arguments
 
+/*
+ Resizes the symbol table of the stack frame ps to alloc symbols. Symbols added are cleared, so
+ that no flag, type or expression of a new symbol comes from stale heap data.
+*/
+void growStkFrame(PSTKFRAME ps, int alloc)
+{
+    int oldAlloc = ps->alloc;
+
+    ps->alloc = alloc;
+    ps->sym = allocVar(ps->sym, alloc * sizeof(STKSYM));
+    if (alloc > oldAlloc)
+        memset(&ps->sym[oldAlloc], 0, (alloc - oldAlloc) * sizeof(STKSYM));
+}
+
 /*
  Updates the argument table by including the register(s) (ie. lhs of picode)
  and the actual expression (ie. rhs of picode).
@@ -117,13 +246,13 @@ void newRegArg(PPROC pproc, PICODE picode, PICODE ticode)
     uint8_t regL, regH; // Registers involved in arguments
 
     // Flag ticode as having register arguments
-    tproc = ticode->hl.oper.call.proc;
+    tproc = icodeHl(ticode).oper.call.proc;
     tproc->flg |= REG_ARGS;
 
     // Get registers and index into target procedure's local list
-    ps = ticode->hl.oper.call.args;
+    ps = icodeHl(ticode).oper.call.args;
     ts = &tproc->args;
-    lhs = picode->hl.oper.asgn.lhs;
+    lhs = icodeHl(picode).oper.asgn.lhs;
     type = lhs->expr.ident.idType;
     if (type == REGISTER) {
         regL = pproc->localId.id[lhs->expr.ident.idNode.regiIdx].id.regi;
@@ -153,12 +282,12 @@ void newRegArg(PPROC pproc, PICODE picode, PICODE ticode)
         }
     }
 
-    // Do ts (formal arguments)
+    // Do ts (formal arguments), whose expressions belong to the target procedure
     if (regExist == false) {
-        if (ts->csym == ts->alloc) {
-            ts->alloc += 5;
-            ts->sym = allocVar(ts->sym, ts->alloc * sizeof(STKSYM));
-        }
+        EXP_ARENA *prevArena = setExpArena(&tproc->expArena);
+
+        if (ts->csym == ts->alloc)
+            growStkFrame(ts, ts->alloc + 5);
         sprintf(ts->sym[ts->csym].name, "arg%d", ts->csym);
         if (type == REGISTER) {
             if (regL < rAL) {
@@ -178,15 +307,14 @@ void newRegArg(PPROC pproc, PICODE picode, PICODE ticode)
 
         ts->csym++;
         ts->numArgs++;
+        setExpArena(prevArena);
     }
 
     // Do ps (actual arguments)
-    if (ps->csym == ps->alloc) {
-        ps->alloc += 5;
-        ps->sym = allocVar(ps->sym, ps->alloc * sizeof(STKSYM));
-    }
+    if (ps->csym == ps->alloc)
+        growStkFrame(ps, ps->alloc + 5);
     sprintf(ps->sym[ps->csym].name, "arg%d", ps->csym);
-    ps->sym[ps->csym].actual = picode->hl.oper.asgn.rhs;
+    ps->sym[ps->csym].actual = icodeHl(picode).oper.asgn.rhs;
     ps->sym[ps->csym].regs = lhs;
 
     // Mask off high and low register(s) in picode
@@ -218,11 +346,10 @@ void allocStkArgs(PICODE picode, int num)
 {
     PSTKFRAME ps;
 
-    ps = picode->hl.oper.call.args;
-    ps->alloc = num;
+    ps = icodeHl(picode).oper.call.args;
+    growStkFrame(ps, num);
     ps->csym = num;
     ps->numArgs = num;
-    ps->sym = allocVar(ps->sym, ps->alloc * sizeof(STKSYM));
 }
 
 
@@ -252,11 +379,9 @@ bool newStkArg(PICODE picode, COND_EXPR *exp, llIcode opcode, PPROC pproc)
     }
 
     // Place register argument on the argument list
-    ps = picode->hl.oper.call.args;
-    if (ps->csym == ps->alloc) {
-        ps->alloc += 5;
-        ps->sym = allocVar(ps->sym, ps->alloc * sizeof(STKSYM));
-    }
+    ps = icodeHl(picode).oper.call.args;
+    if (ps->csym == ps->alloc)
+        growStkFrame(ps, ps->alloc + 5);
     ps->sym[ps->csym].actual = exp;
     ps->csym++;
     ps->numArgs++;
@@ -268,7 +393,7 @@ void placeStkArg(PICODE picode, COND_EXPR *exp, int pos)
 {
     PSTKFRAME ps;
 
-    ps = picode->hl.oper.call.args;
+    ps = icodeHl(picode).oper.call.args;
     ps->sym[pos].actual = exp;
     sprintf(ps->sym[pos].name, "arg%d", pos);
 }
@@ -184,8 +184,8 @@ static void longJCond23(COND_EXPR *rhs, COND_EXPR *lhs, PICODE pIcode, int *idx,
     // Update statistics
     obb1->flg |= INVALID_BB;
     obb2->flg |= INVALID_BB;
-    stats.numBBaft -= 2;
-    stats.numEdgesAft -= 4;
+    pProc->stats.numBBaft -= 2;
+    pProc->stats.numEdgesAft -= 4;
 
     invalidateIcode(pIcode);
     invalidateIcode(&pProc->Icode.icode[obb1->start]);
@@ -198,7 +198,7 @@ static void longJCond23(COND_EXPR *rhs, COND_EXPR *lhs, PICODE pIcode, int *idx,
  Removes excess nodes from the graph by flagging them,
  and updates the new edges for the remaining nodes.
 */
-static void longJCond22(COND_EXPR *rhs, COND_EXPR *lhs, PICODE pIcode, int *idx)
+static void longJCond22(COND_EXPR *rhs, COND_EXPR *lhs, PICODE pIcode, int *idx, PPROC pProc)
 {
     int j;
     PBB pbb, obb1, tbb;
@@ -254,8 +254,8 @@ static void longJCond22(COND_EXPR *rhs, COND_EXPR *lhs, PICODE pIcode, int *idx)
 
         // Update statistics
         obb1->flg |= INVALID_BB;
-        stats.numBBaft--;
-        stats.numEdgesAft -= 2;
+        pProc->stats.numBBaft--;
+        pProc->stats.numEdgesAft -= 2;
     }
 
     invalidateIcode(pIcode);
@@ -338,7 +338,7 @@ static void propLongStk(int i, ID *pLocId, PPROC pProc)
            This requires 2 CMPs and 2 branches */
         else if ((pIcode->ll.opcode == iCMP) && isLong22(pIcode, pEnd, &off)) {
             if (checkLongEq(pLocId->id.longStkId, pIcode, i, idx, pProc, &rhs, &lhs, off) == true)
-                longJCond22(rhs, lhs, pIcode, &idx);
+                longJCond22(rhs, lhs, pIcode, &idx, pProc);
         }
     }
 }
@@ -504,7 +504,7 @@ static void propLongReg(int i, ID *pLocId, PPROC pProc)
                    This requires 2 CMPs and 2 branches */
                 else if ((pIcode->ll.opcode == iCMP) && (isLong22(pIcode, pEnd, &off))) {
                     if (checkLongRegEq(pLocId->id.longId, pIcode, i, idx, pProc, &rhs, &lhs, off) == true)
-                        longJCond22(rhs, lhs, pIcode, &idx);
+                        longJCond22(rhs, lhs, pIcode, &idx, pProc);
                 }
 
                 /* Check for OR regH, regL
@@ -27,7 +27,23 @@
 #include <stdlib.h>
 #include <string.h>
 
-static int numInt; // Number of intervals
+#define INT_BLOCK_SIZE 4096 // # bytes of a block of the interval pool
+
+static _Thread_local int numInt; // Number of intervals
+
+// Block of the interval pool
+typedef struct _intBlock {
+    struct _intBlock *next;                      // Next block
+    int used;                                    // # bytes of data allocated
+    void *data[INT_BLOCK_SIZE / sizeof(void *)]; // Data, aligned for pointers
+} INT_BLOCK;
+
+/* Pool of the intervals and queue nodes of the derived sequence being built by this thread.
+   The blocks are kept from one procedure to the next: freeDerivedSeq() rewinds the pool. */
+static _Thread_local struct {
+    INT_BLOCK *first; // First block
+    INT_BLOCK *curr;  // Block being filled, NULL if none
+} intPool;
 
 // Returns whether the queue q is empty or not
 #define nonEmpty(q) (q != NULL)
@@ -36,16 +52,40 @@ static int numInt; // Number of intervals
 #define trivialGraph(G) (G->numOutEdges == 0)
 
 
+// Returns cb uninitialised bytes from the interval pool
+static void *allocIntPool(int cb)
+{
+    INT_BLOCK *b = intPool.curr;
+
+    cb = (cb + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+    if (!b || (b->used + cb > (int)sizeof(b->data))) {
+        if (b && b->next) // Reuse the next block
+            b = b->next;
+        else {
+            INT_BLOCK *newBlock = allocStruc(INT_BLOCK);
+            newBlock->next = NULL;
+            if (b)
+                b->next = newBlock;
+            else
+                intPool.first = newBlock;
+            b = newBlock;
+        }
+        b->used = 0;
+        intPool.curr = b;
+    }
+
+    b->used += cb;
+    return (char *)b->data + b->used - cb;
+}
+
 /*
  Returns the first element in the queue Q, and removes this element from the list.
  Q is not an empty queue.
 */
 static BB *firstOfQueue(queue **Q)
 {
-    queue *elim = *Q;       // Pointer to first node
     BB *first = (*Q)->node; // First element
     *Q = (*Q)->next;        // Pointer to next node
-    free(elim);             // Free storage
 
     return first;
 }
@@ -54,11 +94,11 @@ static BB *firstOfQueue(queue **Q)
  Appends pointer to node at the end of the queue Q if node is not present in this queue.
  Returns the queue node just appended.
 */
-queue *appendQueue(queue **Q, BB *node)
+static queue *appendQueue(queue **Q, BB *node)
 {
     queue *pq, *l;
 
-    pq = allocStruc(queue);
+    pq = allocIntPool(sizeof(queue));
     pq->node = node;
     pq->next = NULL;
 
@@ -144,15 +184,16 @@ static void findIntervals(derSeq *derivedGi)
     int i;             // Counter
     queue *H;          // Queue of possible header nodes
     bool first = true; // First pass through the loop
+    static BB noInt;   // Reaching interval header of the first node, which has none
 
     H = appendQueue(NULL, derivedGi->Gi); // H = {first node of G}
     derivedGi->Gi->beenOnH = true;
-    derivedGi->Gi->reachingInt = allocStruc(BB); // ^ empty BB
+    derivedGi->Gi->reachingInt = &noInt; // ^ empty BB
 
     // Process header nodes list H
     while (nonEmpty(H)) {
         header = firstOfQueue(&H);
-        pI = memset(allocStruc(interval), 0, sizeof(interval));
+        pI = memset(allocIntPool(sizeof(interval)), 0, sizeof(interval));
         pI->numInt = (uint8_t)numInt++;
 
         if (first) // ^ to first interval
@@ -195,18 +236,19 @@ static void findIntervals(derSeq *derivedGi)
     }
 }
 
-// Displays the intervals of the graph Gi.
-static void displayIntervals(interval *pI)
+// Writes the intervals of the graph Gi into sb.
+static void displayIntervals(strBuf *sb, interval *pI)
 {
     while (pI) {
         queue *nodePtr = pI->nodes;
-        printf("  Interval #: %hhu\t#OutEdges: %hhu\n", pI->numInt, pI->numOutEdges);
+        appendStrBuf(sb, "  Interval #: %hhu\t#OutEdges: %hhu\n", pI->numInt, pI->numOutEdges);
 
         while (nodePtr) {
             if (nodePtr->node->correspInt == NULL) // real BBs
-                printf("    Node: %d\n", nodePtr->node->start);
+                appendStrBuf(sb, "    Node: %d\n", nodePtr->node->start);
             else // BBs represent intervals
-                printf("   Node (corresp int): %d\n", nodePtr->node->correspInt->numInt);
+                appendStrBuf(sb, "   Node (corresp int): %d\n",
+                             nodePtr->node->correspInt->numInt);
             nodePtr = nodePtr->next;
         }
         pI = pI->next;
@@ -220,55 +262,44 @@ static derSeq *newDerivedSeq(void)
     return pder;
 }
 
-// Frees the storage allocated for the queue q
-static void freeQueue(queue **q)
-{
-    queue *queuePtr;
-
-    for (queuePtr = *q; queuePtr; queuePtr = *q) {
-        *q = (*q)->next;
-        free(queuePtr);
-    }
-}
-
-// Frees the storage allocated for the interval pI
-static void freeInterval(interval **pI)
-{
-    interval *Iptr;
-
-    while (*pI) {
-        freeQueue(&((*pI)->nodes));
-        Iptr = *pI;
-        *pI = (*pI)->next;
-        free(Iptr);
-    }
-}
-
 /*
- Frees the storage allocated by the derived sequence structure,
- except for the original graph cfg (derivedG->Gi).
+ Frees the storage allocated by the derived sequence structure, except for the graphs
+ (derivedG->Gi), whose BBs go with the procedure's BB pool. Its intervals go with the
+ interval pool, which is rewound for the next derived sequence.
 */
 void freeDerivedSeq(derSeq *derivedG)
 {
     derSeq *derivedGi;
 
-    while (derivedG) {
-        freeInterval(&(derivedG->Ii));
-
-        if (derivedG->Gi->nodeType == INTERVAL_NODE)
-            freeCFG(derivedG->Gi);
+    intPool.curr = intPool.first;
+    if (intPool.curr)
+        intPool.curr->used = 0;
 
+    while (derivedG) {
         derivedGi = derivedG;
         derivedG = derivedG->next;
         free(derivedGi);
     }
 }
 
+// Frees the blocks of this thread's interval pool
+void freeIntPool(void)
+{
+    INT_BLOCK *b = intPool.first;
+
+    while (b) {
+        INT_BLOCK *next = b->next;
+        free(b);
+        b = next;
+    }
+    intPool.first = intPool.curr = NULL;
+}
+
 /*
  Finds the next order graph of derivedGi->Gi according to its intervals (derivedGi->Ii),
- and places it in derivedGi->next->Gi.
+ and places it in derivedGi->next->Gi. Its BBs come from the BB pool of pProc.
 */
-static uint8_t nextOrderGraph(derSeq *derivedGi)
+static uint8_t nextOrderGraph(derSeq *derivedGi, PPROC pProc)
 {
     BB *BBnode,                    // New basic block of intervals
        *curr,                      // BB being checked for out edges
@@ -287,7 +318,7 @@ static uint8_t nextOrderGraph(derSeq *derivedGi)
 
     while (Ii) {
         i = 0;
-        BBnode = newBB(BBnode, -1, -1, INTERVAL_NODE, Ii->numOutEdges, NULL);
+        BBnode = newBB(BBnode, -1, -1, INTERVAL_NODE, Ii->numOutEdges, pProc);
         BBnode->correspInt = Ii;
         listIi = Ii->nodes;
 
@@ -337,7 +368,7 @@ static uint8_t nextOrderGraph(derSeq *derivedGi)
  Finds the derived sequence of the graph derivedG->Gi (ie. cfg).
  Constructs the n-th order graph and places all the intermediate graphs in the derivedG list sequence.
 */
-static uint8_t findDerivedSeq(derSeq *derivedGi)
+static uint8_t findDerivedSeq(derSeq *derivedGi, PPROC pProc)
 {
     BB *Gi = derivedGi->Gi; // Current derived sequence graph
 
@@ -346,16 +377,16 @@ static uint8_t findDerivedSeq(derSeq *derivedGi)
         findIntervals(derivedGi);
 
         // Create Gi+1 and check if it is equivalent to Gi
-        if (!nextOrderGraph(derivedGi))
+        if (!nextOrderGraph(derivedGi, pProc))
             break;
 
         derivedGi = derivedGi->next;
         Gi = derivedGi->Gi;
-        stats.nOrder++;
+        pProc->stats.nOrder++;
     }
 
     if (!trivialGraph(Gi)) {
-        freeDerivedSeq(derivedGi->next); // remove Gi+1
+        free(derivedGi->next); // remove Gi+1, which has no intervals yet
         derivedGi->next = NULL;
         return false;
     }
@@ -367,15 +398,15 @@ static uint8_t findDerivedSeq(derSeq *derivedGi)
 // Converts the irreducible graph G into an equivalent reducible one, by means of node splitting.
 // static void nodeSplitting(BB *G) {}
 
-// Displays the derived sequence and intervals of the graph G
-void displayDerivedSeq(derSeq *derGi)
+// Writes the derived sequence and intervals of the graph G into sb
+void displayDerivedSeq(strBuf *sb, derSeq *derGi)
 {
     int n = 1; // Derived sequence number
-    printf("\nDerived Sequence Intervals\n");
+    appendStrBuf(sb, "\nDerived Sequence Intervals\n");
 
     while (derGi) {
-        printf("\nIntervals for G%X\n", n++);
-        displayIntervals(derGi->Ii);
+        appendStrBuf(sb, "\nIntervals for G%X\n", n++);
+        displayIntervals(sb, derGi->Ii);
         derGi = derGi->next;
     }
 }
@@ -388,10 +419,10 @@ void displayDerivedSeq(derSeq *derGi)
 void checkReducibility(PPROC pProc, derSeq **derivedG)
 {
     numInt = 1;       // reinitialize no. of intervals
-    stats.nOrder = 1; // nOrder(cfg) = 1
+    pProc->stats.nOrder = 1; // nOrder(cfg) = 1
     *derivedG = newDerivedSeq();
     (*derivedG)->Gi = pProc->cfg;
-    uint8_t reducible = findDerivedSeq(*derivedG); // Reducible graph flag
+    uint8_t reducible = findDerivedSeq(*derivedG, pProc); // Reducible graph flag
 
     if (!reducible)
         pProc->flg |= GRAPH_IRRED;
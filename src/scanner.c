@@ -24,13 +24,58 @@
  (C) Cristina Cifuentes, Jeff Ledermann
 */
 
-#include "scanner.h"
 #include "dcc.h"
+#include "scanner.h"
+#include <stdlib.h>
 #include <string.h>
 
+#define CHUNK_SIZE   0x1000 // Bytes of image swept by one predecode task
+#define MAX_INST_LEN 16     // Bytes an instruction may read, incl. prefixes
+
+#define NOT_CACHED   (-1)   // PREDECODED.err of an instruction whose bytes were written to
+
+// Operand of a predecoded instruction, the ICODEMEM fields decode() sets
+typedef struct {
+    int16_t off;
+    uint8_t seg;
+    uint8_t segOver;
+    uint8_t regi;
+} PREDECODED_MEM;
+
+/* An instruction decoded by predecode(): the fields of the icode decode() sets, packed, and
+   all else decode() returned for it. Its image offset is given by its place in the cache. */
+typedef struct {
+    uint32_t flg;            // ll.flg
+    uint32_t immed;          // ll.immed.op
+    PREDECODED_MEM dst;      // ll.dst
+    PREDECODED_MEM src;      // ll.src
+    uint8_t opcode;          // ll.opcode
+    uint8_t numBytes;        // ll.numBytes
+    DU flagDU;               // ll.flagDU
+    int8_t err;              // Error returned by decode(), or NOT_CACHED
+    uint8_t numRelocLookups; // # relocation lookups made while decoding it
+    uint8_t numRelocHits;    // # lookups that found a relocated word
+} PREDECODED;
+
+// Instructions found by the sweep of one chunk of the image
+typedef struct {
+    PREDECODED *entry;
+    uint32_t *label;         // Image offset of each entry
+    int numEntries;
+    int allocEntries;
+} PREDECODE_CHUNK;
+
+/* Predecode cache of the image; empty unless predecode() was called. The entry of the
+   instruction at ip is found by counting the instructions before it in the start bitmap. */
 static struct {
-    void (*state1)(int);
-    void (*state2)(int);
+    uint64_t *start;         // Bit set at the image offset of each entry
+    uint32_t *rank;          // # entries before each word of start
+    PREDECODED *entry;       // Instructions in image order
+} cache;
+
+static struct {
+    void (*state1)(DECODER *, int);
+    void (*state2)(DECODER *, int);
     uint32_t flg;
     llIcode opcode;
     uint8_t df;
@@ -295,15 +340,21 @@ static struct {
 };
 
 
-static uint16_t SegPrefix, RepPrefix;
-static uint8_t *pInst; // Ptr. to current byte of instruction
-static PICODE pIcode;  // Ptr to Icode record filled in by scan()
+// Sets up the decoder d to decode instructions from the image of cbImage bytes
+void initDecoder(DECODER *d, uint8_t *image, uint32_t cbImage, uint8_t *relocMap)
+{
+    memset(d, 0, sizeof(DECODER));
+    d->image = image;
+    d->cbImage = cbImage;
+    d->relocMap = relocMap;
+}
 
 /*
- Scans one machine instruction at offset ip in prog.Image and returns error.
- At the same time, fill in low-level icode details for the scanned inst.
+ Decodes one machine instruction at offset ip in the decoder's image and returns error.
+ At the same time, fill in low-level icode details for the decoded inst. The decoder keeps
+ all its state in d, so several threads can decode at once, each with its own decoder.
 */
-int scan(uint32_t ip, PICODE p)
+int decode(DECODER *d, uint32_t ip, PICODE p)
 {
     int op;
 
@@ -311,52 +362,247 @@ int scan(uint32_t ip, PICODE p)
     p->type = LOW_LEVEL;
     p->ll.label = ip; // ip is absolute offset into image
 
-    if (ip >= prog.cbImage) {
+    if (ip >= d->cbImage) {
         return (IP_OUT_OF_RANGE);
     }
 
-    SegPrefix = RepPrefix = 0;
-    pInst = prog.Image + ip;
-    pIcode = p;
+    d->segPrefix = d->repPrefix = 0;
+    d->pInst = d->image + ip;
+    d->pIcode = p;
 
     do {
-        op = *pInst++;                           // First state - trivial
+        op = *d->pInst++;                     // First state - trivial
         p->ll.opcode = stateTable[op].opcode; // Convert to Icode.opcode
         p->ll.flg = stateTable[op].flg & ICODEMASK;
         p->ll.flagDU.d = stateTable[op].df;
         p->ll.flagDU.u = stateTable[op].uf;
 
-        (*stateTable[op].state1)(op); // Second state
-        (*stateTable[op].state2)(op); // Third state
+        (*stateTable[op].state1)(d, op); // Second state
+        (*stateTable[op].state2)(d, op); // Third state
 
     } while (stateTable[op].state1 == prefix); // Loop if prefix
 
     if (p->ll.opcode) {
         // Save bytes of image used
-        p->ll.numBytes = ((pInst - prog.Image) - ip);
-        return ((SegPrefix) ? FUNNY_SEGOVR : (RepPrefix ? FUNNY_REP : 0)); // Seg. Override invalid
-                                                                           // REP prefix invalid
+        p->ll.numBytes = ((d->pInst - d->image) - ip);
+        // Seg. Override invalid, REP prefix invalid
+        return ((d->segPrefix) ? FUNNY_SEGOVR : (d->repPrefix ? FUNNY_REP : 0));
     }
     // Else opcode error
     return ((stateTable[op].flg & OP386) ? INVALID_386OP : INVALID_OPCODE);
 }
 
+// Returns the predecode cache entry of the instruction at ip, or NULL if there is none
+static PREDECODED *cachedInst(uint32_t ip)
+{
+    if (!cache.start || ip >= prog.cbImage)
+        return NULL;
+
+    uint64_t w = cache.start[ip >> 6];
+    uint64_t bit = (uint64_t)1 << (ip & 63);
+
+    if (!(w & bit))
+        return NULL;
+
+    PREDECODED *pe = &cache.entry[cache.rank[ip >> 6] + __builtin_popcountll(w & (bit - 1))];
+    return (pe->err == NOT_CACHED) ? NULL : pe;
+}
+
+// Packs the fields of p set by decode() into pe
+static void packInst(PICODE p, PREDECODED *pe)
+{
+    pe->flg = p->ll.flg;
+    pe->immed = p->ll.immed.op;
+    pe->dst.off = p->ll.dst.off;
+    pe->dst.seg = p->ll.dst.seg;
+    pe->dst.segOver = p->ll.dst.segOver;
+    pe->dst.regi = p->ll.dst.regi;
+    pe->src.off = p->ll.src.off;
+    pe->src.seg = p->ll.src.seg;
+    pe->src.segOver = p->ll.src.segOver;
+    pe->src.regi = p->ll.src.regi;
+    pe->opcode = p->ll.opcode;
+    pe->numBytes = p->ll.numBytes;
+    pe->flagDU = p->ll.flagDU;
+}
+
+// Fills in p as decode() did for the instruction at ip, from its packed form pe
+static void unpackInst(PREDECODED *pe, uint32_t ip, PICODE p)
+{
+    memset(p, 0, sizeof(ICODE));
+    p->type = LOW_LEVEL;
+    p->ll.label = ip;
+    p->ll.flg = pe->flg;
+    p->ll.immed.op = pe->immed;
+    p->ll.dst.off = pe->dst.off;
+    p->ll.dst.seg = pe->dst.seg;
+    p->ll.dst.segOver = pe->dst.segOver;
+    p->ll.dst.regi = pe->dst.regi;
+    p->ll.src.off = pe->src.off;
+    p->ll.src.seg = pe->src.seg;
+    p->ll.src.segOver = pe->src.segOver;
+    p->ll.src.regi = pe->src.regi;
+    p->ll.opcode = pe->opcode;
+    p->ll.numBytes = pe->numBytes;
+    p->ll.flagDU = pe->flagDU;
+}
+
+/*
+ Scans one machine instruction at offset ip in prog.Image and returns error.
+ At the same time, fill in low-level icode details for the scanned inst.
+*/
+int scan(uint32_t ip, PICODE p)
+{
+    DECODER d;
+
+    PREDECODED *pe = cachedInst(ip);
+    if (pe) {
+        unpackInst(pe, ip, p);
+        stats.numRelocLookups += pe->numRelocLookups;
+        stats.numRelocHits += pe->numRelocHits;
+        stats.numPredecodeHits++;
+        return pe->err;
+    }
+
+    initDecoder(&d, prog.Image, prog.cbImage, prog.relocMap);
+    int err = decode(&d, ip, p);
+
+    stats.numRelocLookups += d.numRelocLookups;
+    stats.numRelocHits += d.numRelocHits;
+    return err;
+}
+
+// sweepChunk - Linear-sweeps chunk c of the image, decoding instructions back to back
+static void sweepChunk(int c, void *arg)
+{
+    PREDECODE_CHUNK *pc = (PREDECODE_CHUNK *)arg + c;
+    DECODER d;
+    uint32_t ip = (uint32_t)c * CHUNK_SIZE;
+    uint32_t end = ip + CHUNK_SIZE;
+
+    // Stop short of the end of the image, so that no decode reads past it
+    if (end > prog.cbImage - MAX_INST_LEN)
+        end = prog.cbImage - MAX_INST_LEN;
+
+    initDecoder(&d, prog.Image, prog.cbImage, prog.relocMap);
+    while (ip < end) {
+        ICODE icode;
+
+        d.numRelocLookups = d.numRelocHits = 0;
+        int err = decode(&d, ip, &icode);
+        uint32_t numRead = d.pInst - d.image - ip;
+
+        // Instructions reading more than MAX_INST_LEN bytes (long runs of prefixes) are left out
+        if (numRead <= MAX_INST_LEN) {
+            if (pc->numEntries == pc->allocEntries) {
+                pc->allocEntries += 256;
+                pc->entry = allocVar(pc->entry, pc->allocEntries * sizeof(PREDECODED));
+                pc->label = allocVar(pc->label, pc->allocEntries * sizeof(uint32_t));
+            }
+            PREDECODED *pe = &pc->entry[pc->numEntries];
+
+            packInst(&icode, pe);
+            pe->err = err;
+            pe->numRelocLookups = d.numRelocLookups;
+            pe->numRelocHits = d.numRelocHits;
+            pc->label[pc->numEntries++] = ip;
+        }
+
+        // Resynchronise on the next byte after a bad opcode
+        ip += (err || icode.ll.numBytes == 0) ? 1 : icode.ll.numBytes;
+    }
+}
+
+/*
+ predecode - Decodes the image ahead of parsing into the predecode cache. The image is cut into
+ chunks that are swept in parallel, each from its first byte, so the cache holds the
+ instructions of a linear sweep; scan() takes an address from the cache when the sweep reached
+ it, and decodes it as before otherwise.
+*/
+void predecode(void)
+{
+    if (prog.cbImage <= MAX_INST_LEN)
+        return;
+
+    int numChunks = (prog.cbImage + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    PREDECODE_CHUNK *chunk = allocMem(numChunks * sizeof(PREDECODE_CHUNK));
+    memset(chunk, 0, numChunks * sizeof(PREDECODE_CHUNK));
+
+    parallelFor(numChunks, sweepChunk, chunk);
+
+    // Gather the chunks, in image order, into one array, and flag where each entry starts
+    int numEntries = 0;
+    for (int c = 0; c < numChunks; c++)
+        numEntries += chunk[c].numEntries;
+
+    int numWords = (prog.cbImage + 63) >> 6;
+    cache.entry = allocMem((numEntries ? numEntries : 1) * sizeof(PREDECODED));
+    cache.start = memset(allocMem(numWords * sizeof(uint64_t)), 0, numWords * sizeof(uint64_t));
+    cache.rank = allocMem(numWords * sizeof(uint32_t));
+
+    numEntries = 0;
+    for (int c = 0; c < numChunks; c++) {
+        memcpy(&cache.entry[numEntries], chunk[c].entry, chunk[c].numEntries * sizeof(PREDECODED));
+        numEntries += chunk[c].numEntries;
+        for (int i = 0; i < chunk[c].numEntries; i++)
+            cache.start[chunk[c].label[i] >> 6] |= (uint64_t)1 << (chunk[c].label[i] & 63);
+        free(chunk[c].entry);
+        free(chunk[c].label);
+    }
+    free(chunk);
+
+    for (int w = 0, n = 0; w < numWords; w++) {
+        cache.rank[w] = n;
+        n += __builtin_popcountll(cache.start[w]);
+    }
+
+    stats.numPredecoded = numEntries;
+}
+
+/*
+ invalidatePredecode - Drops from the predecode cache the instructions that read any of the len
+ bytes at start, which the parser has just written to. scan() decodes them again from the image.
+*/
+void invalidatePredecode(uint32_t start, uint32_t len)
+{
+    uint32_t ip = (start >= MAX_INST_LEN - 1) ? start - (MAX_INST_LEN - 1) : 0;
+
+    for (; ip < start + len; ip++) {
+        PREDECODED *pe = cachedInst(ip);
+        if (pe)
+            pe->err = NOT_CACHED;
+    }
+}
+
+// freePredecode - Frees the predecode cache; scan() decodes every address from then on
+void freePredecode(void)
+{
+    free(cache.start);
+    free(cache.rank);
+    free(cache.entry);
+    cache.start = NULL;
+    cache.rank = NULL;
+    cache.entry = NULL;
+}
+
 // relocItem - returns TRUE if word pointed at is in relocation table
-static bool relocItem(uint8_t *p)
+static bool relocItem(DECODER *d, uint8_t *p)
 {
-    uint32_t off = p - prog.Image;
+    uint32_t off = p - d->image;
 
-    for (int i = 0; i < prog.cReloc; i++)
-        if (prog.relocTable[i] == off)
-            return true;
+    d->numRelocLookups++;
+    if (off < d->cbImage && d->relocMap && (d->relocMap[off >> 3] & (1 << (off & 7)))) {
+        d->numRelocHits++;
+        return true;
+    }
     return false;
 }
 
 // getWord - returns next word from image
-static uint16_t getWord(void)
+static uint16_t getWord(DECODER *d)
 {
-    uint16_t w = LH(pInst);
-    pInst += 2;
+    uint16_t w = LH(d->pInst);
+    d->pInst += 2;
     return w;
 }
 
@@ -373,10 +619,10 @@ static int signex(uint8_t b)
  Note: fdst == TRUE is for the r/m part of the field (dest, unless TO_REG)
        fdst == FALSE is for reg part of the field
 */
-static void setAddress(int i, bool fdst, uint16_t seg, int16_t reg, uint16_t off)
+static void setAddress(DECODER *d, int i, bool fdst, uint16_t seg, int16_t reg, uint16_t off)
 {
     // If not to register (i.e. to r/m), and talking about r/m, then this is dest
-    PMEM pm = (!(stateTable[i].flg & TO_REG) == fdst) ? &pIcode->ll.dst : &pIcode->ll.src;
+    PMEM pm = (!(stateTable[i].flg & TO_REG) == fdst) ? &d->pIcode->ll.dst : &d->pIcode->ll.src;
 
     /* Set segment. A later procedure (lookupAddr in proclist.c) will
        provide the value of this segment in the field segValue. */
@@ -398,321 +644,321 @@ static void setAddress(int i, bool fdst, uint16_t seg, int16_t reg, uint16_t off
         pm->regi += rAL - rAX;
 
     if (seg) // So we can catch invalid use of segment overrides
-        SegPrefix = 0;
+        d->segPrefix = 0;
 }
 
 // rm - Decodes r/m part of modrm byte for dst (unless TO_REG) part of icode
-static void rm(int i)
+static void rm(DECODER *d, int i)
 {
-    uint8_t mod = *pInst >> 6;
-    uint8_t rm = *pInst++ & 7;
+    uint8_t mod = *d->pInst >> 6;
+    uint8_t rm = *d->pInst++ & 7;
 
     switch (mod) {
     case 0: // No disp unless rm == 6
         if (rm == 6) {
-            setAddress(i, true, SegPrefix, 0, getWord());
-            pIcode->ll.flg |= WORD_OFF;
+            setAddress(d, i, true, d->segPrefix, 0, getWord(d));
+            d->pIcode->ll.flg |= WORD_OFF;
         } else
-            setAddress(i, true, SegPrefix, rm + INDEXBASE, 0);
+            setAddress(d, i, true, d->segPrefix, rm + INDEXBASE, 0);
         break;
 
     case 1: // 1 byte disp
-        setAddress(i, true, SegPrefix, rm + INDEXBASE, (uint16_t)signex(*pInst++));
+        setAddress(d, i, true, d->segPrefix, rm + INDEXBASE, (uint16_t)signex(*d->pInst++));
         break;
 
     case 2: // 2 byte disp
-        setAddress(i, true, SegPrefix, rm + INDEXBASE, getWord());
-        pIcode->ll.flg |= WORD_OFF;
+        setAddress(d, i, true, d->segPrefix, rm + INDEXBASE, getWord(d));
+        d->pIcode->ll.flg |= WORD_OFF;
         break;
 
     case 3: // reg
-        setAddress(i, true, 0, rm + rAX, 0);
+        setAddress(d, i, true, 0, rm + rAX, 0);
         break;
     }
 
     if ((stateTable[i].flg & NSP) &&
-        (pIcode->ll.src.regi == rSP || pIcode->ll.dst.regi == rSP))
-        pIcode->ll.flg |= NOT_HLL;
+        (d->pIcode->ll.src.regi == rSP || d->pIcode->ll.dst.regi == rSP))
+        d->pIcode->ll.flg |= NOT_HLL;
 }
 
 
 // modrm - Sets up src and dst from modrm byte
-static void modrm(int i)
+static void modrm(DECODER *d, int i)
 {
-    setAddress(i, false, 0, REG(*pInst) + rAX, 0);
-    rm(i);
+    setAddress(d, i, false, 0, REG(*d->pInst) + rAX, 0);
+    rm(d, i);
 }
 
 // segrm - seg encoded as reg of modrm
-static void segrm(int i)
+static void segrm(DECODER *d, int i)
 {
-    int reg = REG(*pInst) + rES;
+    int reg = REG(*d->pInst) + rES;
 
     if (reg > rDS || (reg == rCS && (stateTable[i].flg & TO_REG)))
-        pIcode->ll.opcode = 0;
+        d->pIcode->ll.opcode = 0;
     else {
-        setAddress(i, false, 0, (int16_t)reg, 0);
-        rm(i);
+        setAddress(d, i, false, 0, (int16_t)reg, 0);
+        rm(d, i);
     }
 }
 
 // regop - src/dst reg encoded as low 3 bits of opcode
-static void regop(int i)
+static void regop(DECODER *d, int i)
 {
-    setAddress(i, false, 0, ((int16_t)i & 7) + rAX, 0);
-    pIcode->ll.dst.regi = pIcode->ll.src.regi;
+    setAddress(d, i, false, 0, ((int16_t)i & 7) + rAX, 0);
+    d->pIcode->ll.dst.regi = d->pIcode->ll.src.regi;
 }
 
 
 // segop - seg encoded in middle of opcode
-static void segop(int i)
+static void segop(DECODER *d, int i)
 {
-    setAddress(i, true, 0, (((int16_t)i & 0x18) >> 3) + rES, 0);
+    setAddress(d, i, true, 0, (((int16_t)i & 0x18) >> 3) + rES, 0);
 }
 
 // axImp - Plugs an implied AX dst
-static void axImp(int i)
+static void axImp(DECODER *d, int i)
 {
-    setAddress(i, true, 0, rAX, 0);
+    setAddress(d, i, true, 0, rAX, 0);
 }
 
-static void axSrcIm(int i) // Implied AX source
+static void axSrcIm(DECODER *d, int i) // Implied AX source
 {
-    pIcode->ll.src.regi = rAX;
+    d->pIcode->ll.src.regi = rAX;
 }
 
-static void alImp(int i) // Implied AL source
+static void alImp(DECODER *d, int i) // Implied AL source
 {
-    pIcode->ll.src.regi = rAL;
+    d->pIcode->ll.src.regi = rAL;
 }
 
 // memImp - Plugs implied src memory operand with any segment override
-static void memImp(int i)
+static void memImp(DECODER *d, int i)
 {
-    setAddress(i, false, SegPrefix, 0, 0);
+    setAddress(d, i, false, d->segPrefix, 0, 0);
 }
 
 // memOnly - Instruction is not valid if modrm refers to register (i.e. mod == 3)
-static void memOnly(int i)
+static void memOnly(DECODER *d, int i)
 {
-    if ((*pInst & 0xC0) == 0xC0)
-        pIcode->ll.opcode = 0;
+    if ((*d->pInst & 0xC0) == 0xC0)
+        d->pIcode->ll.opcode = 0;
 }
 
 // memReg0 - modrm for 'memOnly' and Reg field must also be 0
-static void memReg0(int i)
+static void memReg0(DECODER *d, int i)
 {
-    if (REG(*pInst) || (*pInst & 0xC0) == 0xC0)
-        pIcode->ll.opcode = 0;
+    if (REG(*d->pInst) || (*d->pInst & 0xC0) == 0xC0)
+        d->pIcode->ll.opcode = 0;
     else
-        rm(i);
+        rm(d, i);
 }
 
 // immed - Sets up dst and opcode from modrm byte
-static void immed(int i)
+static void immed(DECODER *d, int i)
 {
     static llIcode immedTable[8] = { iADD, iOR, iADC, iSBB, iAND, iSUB, iXOR, iCMP };
     static uint8_t uf[8] = { 0, 0, Cf, Cf, 0, 0, 0, 0 };
 
-    pIcode->ll.opcode = immedTable[REG(*pInst)];
-    pIcode->ll.flagDU.u = uf[REG(*pInst)];
-    pIcode->ll.flagDU.d = (Sf | Zf | Cf);
-    rm(i);
+    d->pIcode->ll.opcode = immedTable[REG(*d->pInst)];
+    d->pIcode->ll.flagDU.u = uf[REG(*d->pInst)];
+    d->pIcode->ll.flagDU.d = (Sf | Zf | Cf);
+    rm(d, i);
 
-    if (pIcode->ll.opcode == iADD || pIcode->ll.opcode == iSUB)
-        pIcode->ll.flg &= ~NOT_HLL; // Allow ADD/SUB SP, immed
+    if (d->pIcode->ll.opcode == iADD || d->pIcode->ll.opcode == iSUB)
+        d->pIcode->ll.flg &= ~NOT_HLL; // Allow ADD/SUB SP, immed
 }
 
 // shift  - Sets up dst and opcode from modrm byte
-static void shift(int i)
+static void shift(DECODER *d, int i)
 {
     static llIcode shiftTable[8] = { iROL, iROR, iRCL, iRCR, iSHL, iSHR, 0, iSAR };
     static uint8_t uf[8] = { 0, 0, Cf, Cf, 0, 0, 0, 0 };
     static uint8_t df[8] = { Cf, Cf, Cf, Cf, Sf | Zf | Cf, Sf | Zf | Cf, 0, Sf | Zf | Cf };
 
-    pIcode->ll.opcode = shiftTable[REG(*pInst)];
-    pIcode->ll.flagDU.u = uf[REG(*pInst)];
-    pIcode->ll.flagDU.d = df[REG(*pInst)];
-    rm(i);
-    pIcode->ll.src.regi = rCL;
+    d->pIcode->ll.opcode = shiftTable[REG(*d->pInst)];
+    d->pIcode->ll.flagDU.u = uf[REG(*d->pInst)];
+    d->pIcode->ll.flagDU.d = df[REG(*d->pInst)];
+    rm(d, i);
+    d->pIcode->ll.src.regi = rCL;
 }
 
 // trans - Sets up dst and opcode from modrm byte
-static void trans(int i)
+static void trans(DECODER *d, int i)
 {
     static llIcode transTable[8] = { iINC, iDEC, iCALL, iCALLF, iJMP, iJMPF, iPUSH, 0 };
     static uint8_t df[8] = { Sf | Zf, Sf | Zf, 0, 0, 0, 0, 0, 0 };
 
-    if ((uint8_t)REG(*pInst) < 2 || !(stateTable[i].flg & B)) { // INC & DEC
-        pIcode->ll.opcode = transTable[REG(*pInst)];         // valid on bytes
-        pIcode->ll.flagDU.d = df[REG(*pInst)];
-        rm(i);
-        memcpy(&pIcode->ll.src, &pIcode->ll.dst, sizeof(ICODEMEM));
-
-        if (pIcode->ll.opcode == iJMP || pIcode->ll.opcode == iCALL ||
-            pIcode->ll.opcode == iCALLF)
-            pIcode->ll.flg |= NO_OPS;
-        else if (pIcode->ll.opcode == iINC || pIcode->ll.opcode == iPUSH ||
-                 pIcode->ll.opcode == iDEC)
-            pIcode->ll.flg |= NO_SRC;
+    if ((uint8_t)REG(*d->pInst) < 2 || !(stateTable[i].flg & B)) { // INC & DEC
+        d->pIcode->ll.opcode = transTable[REG(*d->pInst)];         // valid on bytes
+        d->pIcode->ll.flagDU.d = df[REG(*d->pInst)];
+        rm(d, i);
+        memcpy(&d->pIcode->ll.src, &d->pIcode->ll.dst, sizeof(ICODEMEM));
+
+        if (d->pIcode->ll.opcode == iJMP || d->pIcode->ll.opcode == iCALL ||
+            d->pIcode->ll.opcode == iCALLF)
+            d->pIcode->ll.flg |= NO_OPS;
+        else if (d->pIcode->ll.opcode == iINC || d->pIcode->ll.opcode == iPUSH ||
+                 d->pIcode->ll.opcode == iDEC)
+            d->pIcode->ll.flg |= NO_SRC;
     }
 }
 
 // arith - Sets up dst and opcode from modrm byte
-static void arith(int i)
+static void arith(DECODER *d, int i)
 {
     static llIcode arithTable[8] = { iTEST, 0, iNOT, iNEG, iMUL, iIMUL, iDIV, iIDIV };
     static uint8_t df[8] = { Sf | Zf | Cf, 0, 0, Sf | Zf | Cf, Sf | Zf | Cf,
                              Sf | Zf | Cf, Sf | Zf | Cf, Sf | Zf | Cf };
 
-    uint8_t opcode = pIcode->ll.opcode = arithTable[REG(*pInst)];
-    pIcode->ll.flagDU.d = df[REG(*pInst)];
-    rm(i);
+    uint8_t opcode = d->pIcode->ll.opcode = arithTable[REG(*d->pInst)];
+    d->pIcode->ll.flagDU.d = df[REG(*d->pInst)];
+    rm(d, i);
 
     if (opcode == iTEST) {
         if (stateTable[i].flg & B)
-            data1(i);
+            data1(d, i);
         else
-            data2(i);
+            data2(d, i);
     } else if (!(opcode == iNOT || opcode == iNEG)) {
-        memcpy(&pIcode->ll.src, &pIcode->ll.dst, sizeof(ICODEMEM));
-        setAddress(i, true, 0, rAX, 0); // dst = AX
+        memcpy(&d->pIcode->ll.src, &d->pIcode->ll.dst, sizeof(ICODEMEM));
+        setAddress(d, i, true, 0, rAX, 0); // dst = AX
     } else if (opcode == iNEG || opcode == iNOT)
-        pIcode->ll.flg |= NO_SRC;
+        d->pIcode->ll.flg |= NO_SRC;
 
     if ((opcode == iDIV) || (opcode == iIDIV)) {
-        if ((pIcode->ll.flg & B) != B)
-            pIcode->ll.flg |= IM_TMP_DST;
+        if ((d->pIcode->ll.flg & B) != B)
+            d->pIcode->ll.flg |= IM_TMP_DST;
     }
 }
 
 // data1 - Sets up immed from 1 byte data
-static void data1(int i)
+static void data1(DECODER *d, int i)
 {
-    pIcode->ll.immed.op = (stateTable[i].flg & S) ? signex(*pInst++) : *pInst++;
-    pIcode->ll.flg |= I;
+    d->pIcode->ll.immed.op = (stateTable[i].flg & S) ? signex(*d->pInst++) : *d->pInst++;
+    d->pIcode->ll.flg |= I;
 }
 
 // data2 - Sets up immed from 2 byte data
-static void data2(int i)
+static void data2(DECODER *d, int i)
 {
-    if (relocItem(pInst))
-        pIcode->ll.flg |= SEG_IMMED;
+    if (relocItem(d, d->pInst))
+        d->pIcode->ll.flg |= SEG_IMMED;
 
     /* ENTER is a special case, it does not take a destination operand, but this field
        is being used as the number of bytes to allocate on the stack.
        The procedure level is stored in the immediate field.
        There is no source operand; therefore, the flag flg is set to NO_OPS. */
-    if (pIcode->ll.opcode == iENTER) {
-        pIcode->ll.dst.off = getWord();
-        pIcode->ll.flg |= NO_OPS;
+    if (d->pIcode->ll.opcode == iENTER) {
+        d->pIcode->ll.dst.off = getWord(d);
+        d->pIcode->ll.flg |= NO_OPS;
     } else
-        pIcode->ll.immed.op = getWord();
+        d->pIcode->ll.immed.op = getWord(d);
 
-    pIcode->ll.flg |= I;
+    d->pIcode->ll.flg |= I;
 }
 
 // dispM - 2 byte offset without modrm (== mod 0, rm 6) (Note:TO_REG bits are reversed)
-static void dispM(int i)
+static void dispM(DECODER *d, int i)
 {
-    setAddress(i, false, SegPrefix, 0, getWord());
+    setAddress(d, i, false, d->segPrefix, 0, getWord(d));
 }
 
 //dispN - 2 byte disp as immed relative to ip
-static void dispN(int i)
+static void dispN(DECODER *d, int i)
 {
-    long off = (short)getWord(); // Signed displacement
+    long off = (short)getWord(d); // Signed displacement
 
-    pIcode->ll.immed.op = (uint32_t)(off + (pInst - prog.Image));
-    pIcode->ll.flg |= I;
+    d->pIcode->ll.immed.op = (uint32_t)(off + (d->pInst - d->image));
+    d->pIcode->ll.flg |= I;
 }
 
 // dispS - 1 byte disp as immed relative to ip
-static void dispS(int i)
+static void dispS(DECODER *d, int i)
 {
-    long off = signex(*pInst++); // Signed displacement
+    long off = signex(*d->pInst++); // Signed displacement
 
-    pIcode->ll.immed.op = (uint32_t)(off + (pInst - prog.Image));
-    pIcode->ll.flg |= I;
+    d->pIcode->ll.immed.op = (uint32_t)(off + (d->pInst - d->image));
+    d->pIcode->ll.flg |= I;
 }
 
 // dispF - 4 byte disp as immed 20-bit target address
-static void dispF(int i)
+static void dispF(DECODER *d, int i)
 {
-    uint32_t off = getWord();
-    uint32_t seg = getWord();
+    uint32_t off = getWord(d);
+    uint32_t seg = getWord(d);
 
-    pIcode->ll.immed.op = off + ((uint32_t)seg << 4);
-    pIcode->ll.flg |= I;
+    d->pIcode->ll.immed.op = off + ((uint32_t)seg << 4);
+    d->pIcode->ll.flg |= I;
 }
 
 // prefix - picks up prefix byte for following instruction (LOCK is ignored on purpose)
-static void prefix(int i)
+static void prefix(DECODER *d, int i)
 {
-    if (pIcode->ll.opcode == iREPE || pIcode->ll.opcode == iREPNE)
-        RepPrefix = pIcode->ll.opcode;
+    if (d->pIcode->ll.opcode == iREPE || d->pIcode->ll.opcode == iREPNE)
+        d->repPrefix = d->pIcode->ll.opcode;
     else
-        SegPrefix = pIcode->ll.opcode;
+        d->segPrefix = d->pIcode->ll.opcode;
 }
 
-// strop - checks RepPrefix and converts string instructions accordingly
-static void strop(int i)
+// strop - checks d->repPrefix and converts string instructions accordingly
+static void strop(DECODER *d, int i)
 {
-    if (RepPrefix) {
-        pIcode->ll.opcode +=
-            ((pIcode->ll.opcode == iCMPS || pIcode->ll.opcode == iSCAS) && RepPrefix == iREPE)
-                ? 2
-                : 1;
-        if (pIcode->ll.opcode == iREP_LODS)
-            pIcode->ll.flg |= NOT_HLL;
-        RepPrefix = 0;
+    if (d->repPrefix) {
+        llIcode opcode = d->pIcode->ll.opcode;
+
+        d->pIcode->ll.opcode +=
+            ((opcode == iCMPS || opcode == iSCAS) && d->repPrefix == iREPE) ? 2 : 1;
+        if (d->pIcode->ll.opcode == iREP_LODS)
+            d->pIcode->ll.flg |= NOT_HLL;
+        d->repPrefix = 0;
     }
 }
 
 // escop - esc operands
-static void escop(int i)
+static void escop(DECODER *d, int i)
 {
-    pIcode->ll.immed.op = REG(*pInst) + (uint32_t)((i & 7) << 3);
-    pIcode->ll.flg |= I;
-    rm(i);
+    d->pIcode->ll.immed.op = REG(*d->pInst) + (uint32_t)((i & 7) << 3);
+    d->pIcode->ll.flg |= I;
+    rm(d, i);
 }
 
 // const1
-static void const1(int i)
+static void const1(DECODER *d, int i)
 {
-    pIcode->ll.immed.op = 1;
-    pIcode->ll.flg |= I;
+    d->pIcode->ll.immed.op = 1;
+    d->pIcode->ll.flg |= I;
 }
 
 // const3
-static void const3(int i)
+static void const3(DECODER *d, int i)
 {
-    pIcode->ll.immed.op = 3;
-    pIcode->ll.flg |= I;
+    d->pIcode->ll.immed.op = 3;
+    d->pIcode->ll.flg |= I;
 }
 
 // none1
-static void none1(int i) {}
+static void none1(DECODER *d, int i) {}
 
 // none2 - Sets the NO_OPS flag if the operand is immediate
-static void none2(int i)
+static void none2(DECODER *d, int i)
 {
-    if (pIcode->ll.flg & I)
-        pIcode->ll.flg |= NO_OPS;
+    if (d->pIcode->ll.flg & I)
+        d->pIcode->ll.flg |= NO_OPS;
 }
 
 // Checks for int 34 to int 3B - if so, converts to ESC nn instruction
-static void checkInt(int i)
+static void checkInt(DECODER *d, int i)
 {
-    uint16_t wOp = (uint16_t)pIcode->ll.immed.op;
+    uint16_t wOp = (uint16_t)d->pIcode->ll.immed.op;
 
     if ((wOp >= 0x34) && (wOp <= 0x3B)) {
         /* This is a Borland/Microsoft floating point emulation instruction.
            Treat as if it is an ESC opcode */
-        pIcode->ll.immed.op = wOp - 0x34;
-        pIcode->ll.opcode = iESC;
-        pIcode->ll.flg |= FLOAT_OP;
+        d->pIcode->ll.immed.op = wOp - 0x34;
+        d->pIcode->ll.opcode = iESC;
+        d->pIcode->ll.flg |= FLOAT_OP;
 
-        escop(wOp - 0x34 + 0xD8);
+        escop(d, wOp - 0x34 + 0xD8);
     }
 }
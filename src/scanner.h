@@ -22,35 +22,35 @@
 
 // Scanner functions. (C) Cristina Cifuentes, Jeff Ledermann
 
-static void rm(int i);
-static void modrm(int i);
-static void segrm(int i);
-static void data1(int i);
-static void data2(int i);
-static void regop(int i);
-static void segop(int i);
-static void strop(int i);
-static void escop(int i);
-static void axImp(int i);
-static void alImp(int i);
-static void axSrcIm(int i);
-static void memImp(int i);
-static void memReg0(int i);
-static void memOnly(int i);
-static void dispM(int i);
-static void dispS(int i);
-static void dispN(int i);
-static void dispF(int i);
-static void prefix(int i);
-static void immed(int i);
-static void shift(int i);
-static void arith(int i);
-static void trans(int i);
-static void const1(int i);
-static void const3(int i);
-static void none1(int i);
-static void none2(int i);
-static void checkInt(int i);
+static void rm(DECODER *d, int i);
+static void modrm(DECODER *d, int i);
+static void segrm(DECODER *d, int i);
+static void data1(DECODER *d, int i);
+static void data2(DECODER *d, int i);
+static void regop(DECODER *d, int i);
+static void segop(DECODER *d, int i);
+static void strop(DECODER *d, int i);
+static void escop(DECODER *d, int i);
+static void axImp(DECODER *d, int i);
+static void alImp(DECODER *d, int i);
+static void axSrcIm(DECODER *d, int i);
+static void memImp(DECODER *d, int i);
+static void memReg0(DECODER *d, int i);
+static void memOnly(DECODER *d, int i);
+static void dispM(DECODER *d, int i);
+static void dispS(DECODER *d, int i);
+static void dispN(DECODER *d, int i);
+static void dispF(DECODER *d, int i);
+static void prefix(DECODER *d, int i);
+static void immed(DECODER *d, int i);
+static void shift(DECODER *d, int i);
+static void arith(DECODER *d, int i);
+static void trans(DECODER *d, int i);
+static void const1(DECODER *d, int i);
+static void const3(DECODER *d, int i);
+static void none1(DECODER *d, int i);
+static void none2(DECODER *d, int i);
+static void checkInt(DECODER *d, int i);
 
 // Extracts reg bits from middle of mod-reg-rm byte
 #define REG(x)  ((uint8_t)(x & 0x38) >> 3)
@@ -25,6 +25,8 @@
 
 #include "dcc.h"
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 
 static char *nodeType[] = { "branch", "if", "case", "fall", "return", "call", "loop", "repeat",
@@ -33,72 +35,119 @@ static char *nodeType[] = { "branch", "if", "case", "fall", "return", "call", "l
 static char *loopType[] = { "noLoop", "while", "repeat", "loop", "for" };
 
 
+static PPROC *procs;    // Procedures analysed, in the order of analysis
+static int numProcs;    // # procedures in procs
+static strBuf *procOut; // Listings of procs[i] written by the structuring stage
+
 static void displayCFG(PPROC pProc);
-static void displayStats(PPROC pProc);
-static void displayDfs(PBB pBB);
+static void displayStats(strBuf *sb, PPROC pProc);
+static void displayDfs(strBuf *sb, PBB pBB);
 
 
-void udm(void)
+// Creates the basic control flow graph of procs[i]
+static void buildCFG(int i, void *arg) { procs[i]->cfg = createCFG(procs[i]); }
+
+// Removes redundancies and adds in-edge information to the control flow graph of procs[i]
+static void reduceCFG(int i, void *arg) { compressCFG(procs[i]); }
+
+/*
+ Idiom analysis and propagation of long type, and generation of HIGH_LEVEL icodes whenever
+ possible, for procs[i]. The expressions and HIGH_LEVEL parts go to the procedure's arena.
+*/
+static void genHighLevel(int i, void *arg)
 {
-    PPROC pProc;
+    setExpArena(&procs[i]->expArena);
+    lowLevelAnalysis(procs[i]);
+    packIcode(&procs[i]->Icode); // Labels are no longer searched
+    highLevelGen(procs[i]);
+}
+
+// Control flow analysis of procs[i]. Its listings are written into procOut[i].
+static void structProc(int i, void *arg)
+{
+    PPROC pProc = procs[i];
     derSeq *derivedG;
 
-    // Build the control flow graph, find idioms, and convert low-level icodes to high-level ones
-    for (pProc = pLastProc; pProc; pProc = pProc->prev) {
-        if (pProc->flg & PROC_ISLIB) // Ignore library functions
-            continue;
+    // Make cfg reducible and build derived sequences
+    setExpArena(&pProc->expArena);
+    checkReducibility(pProc, &derivedG);
 
-        // Create the basic control flow graph
-        pProc->cfg = createCFG(pProc);
+    if (option.VeryVerbose)
+        displayDerivedSeq(&procOut[i], derivedG);
 
-        if (option.VeryVerbose)
-            displayCFG(pProc);
+    // Structure the graph
+    structure(pProc, derivedG);
 
-        // Remove redundancies and add in-edge information
-        compressCFG(pProc);
+    // Check for compound conditions
+    compoundCond(pProc);
 
-        if (option.asm2) // Print 2nd pass assembler listing
-            disassem(2, pProc);
+    if (option.verbose) {
+        appendStrBuf(&procOut[i], "\nDepth first traversal - Proc %s\n", pProc->name);
+        displayDfs(&procOut[i], pProc->cfg);
+    }
 
-        // Idiom analysis and propagation of long type
-        lowLevelAnalysis(pProc);
+    // Free storage occupied by this procedure
+    freeDerivedSeq(derivedG);
 
-        // Generate HIGH_LEVEL icodes whenever possible
-        highLevelGen(pProc);
-    }
+    if (option.Stats)
+        displayStats(&procOut[i], pProc);
+}
 
-    /* Data flow analysis - eliminate condition codes, extraneous registers and intermediate
-       instructions. Find expressions by forward substitution algorithm */
-    dataFlow(pProcList, 0);
 
-    // Control flow analysis - structuring algorithm
-    for (pProc = pLastProc; pProc; pProc = pProc->prev) {
-        if (pProc->flg & PROC_ISLIB) // Ignore library functions
-            continue;
+void udm(void)
+{
+    PPROC pProc;
+
+    // Library functions are ignored
+    numProcs = 0;
+    for (pProc = pLastProc; pProc; pProc = pProc->prev)
+        if (!(pProc->flg & PROC_ISLIB))
+            numProcs++;
 
-        // Make cfg reducible and build derived sequences
-        checkReducibility(pProc, &derivedG);
+    procs = allocMem(numProcs * sizeof(PPROC));
+    numProcs = 0;
+    for (pProc = pLastProc; pProc; pProc = pProc->prev)
+        if (!(pProc->flg & PROC_ISLIB))
+            procs[numProcs++] = pProc;
 
-        if (option.VeryVerbose)
-            displayDerivedSeq(derivedG);
+    /* Build the control flow graph, find idioms, and convert low-level icodes to high-level
+       ones. Each stage runs on all procedures at once; the listings are written in order. */
+    parallelFor(numProcs, buildCFG, NULL);
 
-        // Structure the graph
-        structure(pProc, derivedG);
+    if (option.VeryVerbose)
+        for (int i = 0; i < numProcs; i++)
+            displayCFG(procs[i]);
 
-        // Check for compound conditions
-        compoundCond(pProc);
+    parallelFor(numProcs, reduceCFG, NULL);
 
-        if (option.verbose) {
-            printf("\nDepth first traversal - Proc %s\n", pProc->name);
-            displayDfs(pProc->cfg);
-        }
+    if (option.asm2) // Print 2nd pass assembler listing
+        for (int i = 0; i < numProcs; i++)
+            disassem(2, procs[i]);
 
-        // Free storage occupied by this procedure
-        freeDerivedSeq(derivedG);
+    parallelFor(numProcs, genHighLevel, NULL);
 
-        if (option.Stats)
-            displayStats(pProc);
-    }
+    // The calling conventions found are set in the order the procedures would be analysed in
+    for (int i = 0; i < numProcs; i++)
+        setCallConv(procs[i]);
+
+    /* Data flow analysis - eliminate condition codes, extraneous registers and intermediate
+       instructions. Find expressions by forward substitution algorithm */
+    dataFlow(pProcList, 0);
+
+    // Control flow analysis - structuring algorithm. The listings are written in order.
+    procOut = allocMem(numProcs * sizeof(strBuf));
+    memset(procOut, 0, numProcs * sizeof(strBuf));
+    parallelFor(numProcs, structProc, NULL);
+
+    for (int i = 0; i < numProcs; i++)
+        if (procOut[i].str) {
+            fputs(procOut[i].str, stdout);
+            free(procOut[i].str);
+        }
+
+    setExpArena(NULL);
+    free(procOut);
+    free(procs);
 }
 
 // displayCFG - Displays the Basic Block list
@@ -118,55 +167,67 @@ static void displayCFG(PPROC pProc)
     }
 }
 
-// displayStats - Displays statistics on nodes and arcs of the CFG
-static void displayStats(PPROC pProc)
+// displayStats - Writes statistics on nodes and arcs of the CFG into sb
+static void displayStats(strBuf *sb, PPROC pProc)
 {
-    printf("\nStatistics - Proc %s\n", pProc->name);
-    printf("Number of BBs:\n");
-    printf("   Before: %4d\n   After : %4d\n", stats.numBBbef, stats.numBBaft);
-    printf("   Ratio : %2.2f%%\n", 100.0 - (stats.numBBaft * 100.0) / stats.numBBbef);
-    printf("Number outEdges:\n");
-    printf("   Before: %4d\n   After : %4d\n", stats.numEdgesBef, stats.numEdgesAft);
-    printf("nth order = %d\n\n", stats.nOrder);
+    appendStrBuf(sb, "\nStatistics - Proc %s\n", pProc->name);
+    appendStrBuf(sb, "Number of BBs:\n");
+    appendStrBuf(sb, "   Before: %4d\n   After : %4d\n", pProc->stats.numBBbef,
+                 pProc->stats.numBBaft);
+    appendStrBuf(sb, "   Ratio : %2.2f%%\n",
+                 100.0 - (pProc->stats.numBBaft * 100.0) / pProc->stats.numBBbef);
+    appendStrBuf(sb, "Number outEdges:\n");
+    appendStrBuf(sb, "   Before: %4d\n   After : %4d\n", pProc->stats.numEdgesBef,
+                 pProc->stats.numEdgesAft);
+    appendStrBuf(sb, "Construction time (ms):\n");
+    appendStrBuf(sb, "   BBs   : %.3f\n   Edges : %.3f\n", pProc->stats.bbTime,
+                 pProc->stats.edgeTime);
+    appendStrBuf(sb, "nth order = %d\n", pProc->stats.nOrder);
+    appendStrBuf(sb, "Live register analysis:\n");
+    appendStrBuf(sb, "   Passes: %4d\n   Visits: %4d\n", pProc->stats.numLivePasses,
+                 pProc->stats.numLiveVisits);
+    appendStrBuf(sb, "Expression nodes allocated: %d\n\n", pProc->expArena.numNodes);
 }
 
-// displayDfs - Displays the CFG using a depth first traversal
-static void displayDfs(PBB pBB)
+// displayDfs - Writes the CFG into sb using a depth first traversal
+static void displayDfs(strBuf *sb, PBB pBB)
 {
     if (!pBB)
         return;
 
     pBB->traversed = DFS_DISP;
 
-    printf("node type = %s, ", nodeType[pBB->nodeType]);
-    printf("start = %d, length = %d, #in-edges = %d, #out-edges = %d\n", pBB->start,
-           pBB->length, pBB->numInEdges, pBB->numOutEdges);
-    printf("dfsFirst = %d, dfsLast = %d, immed dom = %d\n", pBB->dfsFirstNum, pBB->dfsLastNum,
-           pBB->immedDom == MAX ? -1 : pBB->immedDom);
-    printf("loopType = %s, loopHead = %d, latchNode = %d, follow = %d\n",
-           loopType[pBB->loopType], pBB->loopHead == MAX ? -1 : pBB->loopHead,
-           pBB->latchNode == MAX ? -1 : pBB->latchNode,
-           pBB->loopFollow == MAX ? -1 : pBB->loopFollow);
-    printf("ifFollow = %d, caseHead = %d, caseTail = %d\n",
-           pBB->ifFollow == MAX ? -1 : pBB->ifFollow, pBB->caseHead == MAX ? -1 : pBB->caseHead,
-           pBB->caseTail == MAX ? -1 : pBB->caseTail);
+    appendStrBuf(sb, "node type = %s, ", nodeType[pBB->nodeType]);
+    appendStrBuf(sb, "start = %d, length = %d, #in-edges = %d, #out-edges = %d\n", pBB->start,
+                 pBB->length, pBB->numInEdges, pBB->numOutEdges);
+    appendStrBuf(sb, "dfsFirst = %d, dfsLast = %d, immed dom = %d\n", pBB->dfsFirstNum,
+                 pBB->dfsLastNum, pBB->immedDom == MAX ? -1 : pBB->immedDom);
+    appendStrBuf(sb, "loopType = %s, loopHead = %d, latchNode = %d, follow = %d\n",
+                 loopType[pBB->loopType], pBB->loopHead == MAX ? -1 : pBB->loopHead,
+                 pBB->latchNode == MAX ? -1 : pBB->latchNode,
+                 pBB->loopFollow == MAX ? -1 : pBB->loopFollow);
+    appendStrBuf(sb, "ifFollow = %d, caseHead = %d, caseTail = %d\n",
+                 pBB->ifFollow == MAX ? -1 : pBB->ifFollow,
+                 pBB->caseHead == MAX ? -1 : pBB->caseHead,
+                 pBB->caseTail == MAX ? -1 : pBB->caseTail);
 
     if (pBB->nodeType == INTERVAL_NODE)
-        printf("corresponding interval = %hhu\n", pBB->correspInt->numInt);
+        appendStrBuf(sb, "corresponding interval = %hhu\n", pBB->correspInt->numInt);
     else
         for (int i = 0; i < pBB->numInEdges; i++)
-            printf("  inEdge[%d] = %d\n", i, pBB->inEdges[i]->start);
+            appendStrBuf(sb, "  inEdge[%d] = %d\n", i, pBB->inEdges[i]->start);
 
     // Display out edges information
     for (int i = 0; i < pBB->numOutEdges; i++)
         if (pBB->nodeType == INTERVAL_NODE)
-            printf(" outEdge[%d] = %hhu\n", i, pBB->edges[i].BBptr->correspInt->numInt);
+            appendStrBuf(sb, " outEdge[%d] = %hhu\n", i,
+                         pBB->edges[i].BBptr->correspInt->numInt);
         else
-            printf(" outEdge[%d] = %d\n", i, pBB->edges[i].BBptr->start);
-    printf("----\n");
+            appendStrBuf(sb, " outEdge[%d] = %d\n", i, pBB->edges[i].BBptr->start);
+    appendStrBuf(sb, "----\n");
 
     // Recursive call on successors of current node
     for (int i = 0; i < pBB->numOutEdges; i++)
         if (pBB->edges[i].BBptr->traversed != DFS_DISP)
-            displayDfs(pBB->edges[i].BBptr);
+            displayDfs(sb, pBB->edges[i].BBptr);
 }